@@ -0,0 +1,74 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+#include "../archive.h"
+
+
+using namespace std;
+
+
+
+// Pravi i cita arhive izlaza asemblera sa indeksom globalnih simbola.
+//	c arhiva clan...	pakuje listinge i objektne fajlove (i sa -z)
+//	t arhiva	ispisuje clanove i indeks
+//	x arhiva simbol...	izdvaja clanove koji definisu simbole u tekuci direktorijum
+int main(int argc, char* argv[]) {
+
+	if (argc < 3 || strlen(argv[1]) != 1 || strchr("ctx", argv[1][0]) == nullptr) {
+		cout << "Usage: " << argv[0] << " c archive member... | t archive | x archive symbol..." << endl;
+		return 2;
+	}
+
+	char command = argv[1][0];
+	if (command == 'c') {
+		string message;
+		if (!Archive::create(argv[2], vector<string>(argv + 3, argv + argc), message)) {
+			cout << message << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	Archive archive(argv[2]);
+	if (!archive.isOpen()) {
+		cout << archive.error() << endl;
+		return 1;
+	}
+
+	if (command == 't') {
+		vector<vector<string>> defined(archive.members().size());
+		for (const auto& symbol : archive.symbols()) {
+			defined[symbol.second].push_back(symbol.first);
+		}
+		for (size_t i = 0; i < archive.members().size(); i++) {
+			const ArchiveMember& member = archive.members()[i];
+			cout << member.name << '\t' << member.size << '\t';
+			for (const string& symbol : defined[i]) {
+				cout << symbol << ' ';
+			}
+			cout << endl;
+		}
+		return 0;
+	}
+
+	int status = 0;
+	for (int i = 3; i < argc; i++) {
+		int probes = 0;
+		const ArchiveMember* member = archive.find(argv[i], &probes);
+		if (member == nullptr) {
+			cout << argv[i] << '\t' << "not defined" << '\t' << probes << " probes" << endl;
+			status = 1;
+			continue;
+		}
+		vector<char> data;
+		ofstream ofs(member->name, ios::binary);
+		if (!archive.read(*member, data) || !ofs.write(data.data(), data.size())) {
+			cout << "Error extracting member: " << member->name << endl;
+			return 1;
+		}
+		cout << argv[i] << '\t' << member->name << '\t' << probes << " probes" << endl;
+	}
+
+	return status;
+}
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+#include "../assembler.h"
+
+
+using namespace std;
+
+
+
+// Prevodi isti ulaz vise puta: svaki put sa novim kontekstom, pa ponovo koristeci kontekst
+// prethodnog rezultata (arena se vraca na pocetak). Ispisuje vreme po prevodjenju i zauzece arene.
+int main(int argc, char* argv[]) {
+
+	if (argc < 2) {
+		cout << "Usage: " << argv[0] << " input [runs] [startAddress]" << endl;
+		return 2;
+	}
+
+	ifstream ifs(argv[1], ios::binary);
+	if (!ifs.is_open()) {
+		cout << "Error opening input file: " << argv[1] << endl;
+		return 2;
+	}
+	stringstream buffer;
+	buffer << ifs.rdbuf();
+	string source = buffer.str();
+
+	int runs = (argc > 2) ? atoi(argv[2]) : 1000;
+	Options options;
+	options.startAddress = (argc > 3) ? atoi(argv[3]) : 0;
+
+	Result result = assemble(source, options);
+	if (!result.success) {
+		for (const string& error : result.errors) {
+			cout << error << endl;
+		}
+		return 1;
+	}
+
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < runs; i++) {
+		result = assemble(source, options);
+	}
+	chrono::duration<double> fresh = chrono::steady_clock::now() - start;
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < runs; i++) {
+		result = assemble(source, options, move(result));
+	}
+	chrono::duration<double> reused = chrono::steady_clock::now() - start;
+
+	cout << "new context:    " << fresh.count() / runs * 1e6 << " us per run" << endl;
+	cout << "reused context: " << reused.count() / runs * 1e6 << " us per run" << endl;
+	cout << "arena peak:     " << result.arenaPeak << " bytes" << endl;
+
+	return 0;
+}
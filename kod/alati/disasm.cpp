@@ -0,0 +1,113 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <chrono>
+
+#include "../assembler.h"
+#include "../disassembler.h"
+
+
+using namespace std;
+
+
+
+// Prevodi ulaz bibliotekom i ispisuje disasembliran rezultat.
+// --roundtrip ponovo prevodi izvorni oblik i poredi bajtove, -t meri brzinu listinga.
+int main(int argc, char* argv[]) {
+
+	if (argc < 3) {
+		cout << "Usage: " << argv[0] << " input startAddress [-f listing|source] [--absolute] [--page-size n] [-O] [--layout [--profile file]] [--roundtrip] [-t]" << endl;
+		return 2;
+	}
+
+	Options options;
+	options.startAddress = atoi(argv[2]);
+	Disassembler::Format format = Disassembler::LISTING;
+	bool roundTrip = false;
+	bool timing = false;
+	for (int i = 3; i < argc; i++) {
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "source") == 0) {
+				format = Disassembler::SOURCE;
+			}
+			else if (strcmp(argv[i], "listing") != 0) {
+				cout << "Unknown output format: " << argv[i] << endl;
+				return 2;
+			}
+		}
+		else if (strcmp(argv[i], "--absolute") == 0) {
+			options.absolute = true;
+		}
+		else if (strcmp(argv[i], "-O") == 0) {
+			options.optimize = true;
+		}
+		else if (strcmp(argv[i], "--layout") == 0) {
+			options.layout = true;
+		}
+		else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			options.profile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--page-size") == 0 && i + 1 < argc) {
+			options.pageSize = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--roundtrip") == 0) {
+			roundTrip = true;
+		}
+		else if (strcmp(argv[i], "-t") == 0) {
+			timing = true;
+		}
+		else {
+			cout << "Unknown command line parameter: " << argv[i] << endl;
+			return 2;
+		}
+	}
+
+	ifstream ifs(argv[1], ios::binary);
+	if (!ifs.is_open()) {
+		cout << "Error opening input file: " << argv[1] << endl;
+		return 2;
+	}
+	stringstream buffer;
+	buffer << ifs.rdbuf();
+
+	Result result = assemble(buffer.str(), options);
+	if (!result.success) {
+		for (const string& error : result.errors) {
+			cout << error << endl;
+		}
+		return 1;
+	}
+
+	Disassembler disassembler(result);
+
+	if (roundTrip) {
+		return Disassembler::roundTrip(result, options, cout) ? 0 : 1;
+	}
+
+	string out;
+	disassembler.disassemble(out, format);
+	cout << out;
+
+	if (timing) {
+		size_t bytes = 0;
+		for (const Section& section : result.sections) {
+			if (section.startAddress >= 0 && !section.nobits) {
+				bytes += section.size();
+			}
+		}
+		size_t runs = 0;
+		auto start = chrono::steady_clock::now();
+		chrono::duration<double> elapsed(0);
+		while (elapsed.count() < 1.0) {
+			out.clear();
+			disassembler.disassemble(out, format);
+			runs++;
+			elapsed = chrono::steady_clock::now() - start;
+		}
+		cerr << runs * bytes / elapsed.count() / 1e6 << " MB/s (" << bytes << " bytes, " << runs << " runs)" << endl;
+	}
+
+	return 0;
+}
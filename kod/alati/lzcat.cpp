@@ -0,0 +1,98 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstring>
+#include <chrono>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../lz.h"
+
+
+using namespace std;
+
+
+
+// Raspakuje fajl pisan sa -z na standardni izlaz.
+// -b meri brzinu kompresije i dekompresije proizvoljnog (nekompresovanog) fajla.
+static int benchmark(const char* fileName) {
+	ifstream ifs(fileName, ios::binary);
+	if (!ifs.is_open()) {
+		cerr << "Error opening input file: " << fileName << endl;
+		return 2;
+	}
+	stringstream buffer;
+	buffer << ifs.rdbuf();
+	string data = buffer.str();
+
+	vector<char> compressed(Lz::maxCompressedSize(Lz::BLOCK_SIZE));
+	vector<char> restored(Lz::BLOCK_SIZE);
+	size_t compressedTotal = 0;
+	size_t runs = 0;
+	chrono::duration<double> compressTime(0);
+	chrono::duration<double> decompressTime(0);
+
+	while (compressTime.count() + decompressTime.count() < 2.0) {
+		compressedTotal = 0;
+		for (size_t start = 0; start < data.size(); start += Lz::BLOCK_SIZE) {
+			int length = (int) min(data.size() - start, (size_t) Lz::BLOCK_SIZE);
+			auto t0 = chrono::steady_clock::now();
+			int size = Lz::compressBlock(&data[start], length, compressed.data());
+			auto t1 = chrono::steady_clock::now();
+			int back = Lz::decompressBlock(compressed.data(), size, restored.data(), length);
+			auto t2 = chrono::steady_clock::now();
+			compressTime += t1 - t0;
+			decompressTime += t2 - t1;
+			if (back != length || memcmp(restored.data(), &data[start], length) != 0) {
+				cerr << "Round trip mismatch in block at " << start << endl;
+				return 1;
+			}
+			compressedTotal += size;
+		}
+		runs++;
+	}
+
+	double megabytes = (double) data.size() * runs / 1e6;
+	cout << data.size() << " -> " << compressedTotal << " bytes, ratio " << (double) data.size() / compressedTotal << endl;
+	cout << "compress " << megabytes / compressTime.count() << " MB/s, decompress " << megabytes / decompressTime.count() << " MB/s (" << runs << " runs)" << endl;
+	return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+
+	if (argc < 2) {
+		cout << "Usage: " << argv[0] << " compressedFile | -b file" << endl;
+		return 2;
+	}
+
+	if (strcmp(argv[1], "-b") == 0) {
+		if (argc < 3) {
+			cout << "Usage: " << argv[0] << " -b file" << endl;
+			return 2;
+		}
+		return benchmark(argv[2]);
+	}
+
+	int fd = open(argv[1], O_RDONLY);
+	if (fd < 0) {
+		cerr << "Error opening input file: " << argv[1] << endl;
+		return 2;
+	}
+
+	LzReader reader(fd);
+	vector<char> buffer(Lz::BLOCK_SIZE);
+	size_t n;
+	while ((n = reader.read(buffer.data(), buffer.size())) > 0) {
+		cout.write(buffer.data(), n);
+	}
+	close(fd);
+
+	if (!reader.ok()) {
+		cerr << "Corrupt compressed file: " << argv[1] << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <iomanip>
+
+#include "../objectfile.h"
+
+
+using namespace std;
+
+
+
+// Ucitava -f obj fajl i ispisuje sekcije (adresu, velicinu, zastite i da li je sadrzaj mapiran) simbole i relokacije.
+int main(int argc, char* argv[]) {
+
+	if (argc < 2) {
+		cout << "Usage: " << argv[0] << " objectFile" << endl;
+		return 2;
+	}
+
+	ObjectFile object(argv[1]);
+	if (!object.isOpen()) {
+		cout << object.error() << endl;
+		return 1;
+	}
+
+	cout << "section" << '\t' << "address" << '\t' << '\t' << "size" << '\t' << "prot" << '\t' << "load" << '\t' << "first bytes" << endl;
+	for (const LoadedSection& s : object.sections()) {
+		cout << s.name << '\t' << hex << uppercase << setw(8) << setfill('0') << s.address << '\t' << dec << s.size << '\t';
+		cout << ((s.flags & SECTION_READ) ? 'r' : '-') << ((s.flags & SECTION_WRITE) ? 'w' : '-') << ((s.flags & SECTION_EXEC) ? 'x' : '-') << '\t';
+		cout << ((s.flags & SECTION_NOBITS) ? "anon" : (s.copied ? "copy" : "mmap")) << '\t';
+		for (uint32_t i = 0; i < s.size && i < 8; i++) {
+			cout << hex << setw(2) << setfill('0') << (int) (unsigned char) s.data[i] << ' ';
+		}
+		cout << dec << endl;
+	}
+	cout << "copied bytes: " << object.copiedBytes() << endl;
+
+	const vector<LoadedSymbol>& symbols = object.symbols();
+	cout << "symbols: " << symbols.size() << ", names in " << object.stringBytes() << " bytes" << endl;
+	for (size_t i = 0; i < symbols.size(); i++) {
+		const LoadedSymbol& s = symbols[i];
+		cout << i << '\t' << s.name << '\t' << ((s.section == OBJECT_UNDEFINED) ? "?" : object.sections()[s.section].name) << '\t';
+		cout << hex << uppercase << s.value << dec << '\t' << (s.global ? "global" : "local") << endl;
+	}
+
+	const vector<LoadedRelocation>& relocations = object.relocations();
+	cout << "relocations: " << relocations.size() << " in " << object.relocationBytes() << " bytes" << endl;
+	for (const LoadedRelocation& r : relocations) {
+		cout << object.sections()[r.section].name << '\t' << hex << uppercase << setw(8) << setfill('0') << r.offset << '\t' << dec;
+		cout << (r.type == 0 ? "R_386_32" : "R_386_PC32") << '\t' << r.symbol << endl;
+	}
+
+	return 0;
+}
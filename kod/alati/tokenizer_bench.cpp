@@ -0,0 +1,93 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+#include "../tokenizer.h"
+
+
+using namespace std;
+
+
+
+// Generise izvor od zadatog broja megabajta od tipicnih linija.
+static string generateSource(size_t megabytes) {
+	static const char* lines[] = {
+		"label%d:\n",
+		"\tmov r0, r6[4]\n",
+		"\tadd r7, 2\n",
+		"\tpush r1\n",
+		"\tjmpeq label%d\n",
+		"\t.long 0x12345678, 17, 255, 4096\n",
+		"\tcall printf\r\n",
+		"\n"
+	};
+
+	string source;
+	source.reserve(megabytes * 1024 * 1024 + 64);
+	char buffer[64];
+	for (int i = 0; source.size() < megabytes * 1024 * 1024; i++) {
+		snprintf(buffer, sizeof(buffer), lines[i % 8], i);
+		source += buffer;
+	}
+	return source;
+}
+
+
+template <typename F>
+static double bestSeconds(int repeat, F f) {
+	double best = 1e30;
+	for (int i = 0; i < repeat; i++) {
+		auto start = chrono::steady_clock::now();
+		f();
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		if (elapsed.count() < best) {
+			best = elapsed.count();
+		}
+	}
+	return best;
+}
+
+
+int main(int argc, char* argv[]) {
+	size_t megabytes = (argc > 1) ? (size_t) atoi(argv[1]) : 64;
+	int repeat = (argc > 2) ? atoi(argv[2]) : 5;
+
+	string source = generateSource(megabytes);
+	double gigabytes = source.size() / 1e9;
+	cout << "source: " << source.size() << " bytes" << endl;
+
+	size_t reference = 0;
+	double seconds = bestSeconds(1, [&]() {	// dosadasnji nacin: getline + istringstream >>
+		istringstream ifs(source);
+		string line;
+		reference = 0;
+		while (getline(ifs, line)) {
+			istringstream iss(line);
+			string token;
+			while (iss >> token) {
+				reference++;
+			}
+		}
+	});
+	cout << "istringstream" << '\t' << reference << " tokens" << '\t' << gigabytes / seconds << " GB/s" << endl;
+
+	Tokenizer::Kernel kernels[] = { Tokenizer::SCALAR, Tokenizer::SSE2, Tokenizer::AVX2 };
+	for (Tokenizer::Kernel kernel : kernels) {
+		if (!Tokenizer::supported(kernel)) {
+			continue;
+		}
+		TokenizedSource tokenized;
+		seconds = bestSeconds(repeat, [&]() {
+			Tokenizer::tokenize(source, tokenized, kernel);
+		});
+		cout << Tokenizer::name(kernel) << '\t' << '\t' << tokenized.tokens.size() << " tokens" << '\t' << gigabytes / seconds << " GB/s";
+		if (tokenized.tokens.size() != reference) {
+			cout << '\t' << "MISMATCH";
+		}
+		cout << endl;
+	}
+
+	return 0;
+}
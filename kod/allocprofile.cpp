@@ -0,0 +1,171 @@
+#include "allocprofile.h"
+
+#ifdef ALLOC_PROFILE
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace {
+
+struct Counter {
+	atomic<unsigned long long> count;
+	atomic<unsigned long long> bytes;
+	atomic<unsigned long long> frees;
+};
+
+Counter counters[PHASE_COUNT][CATEGORY_COUNT];
+
+thread_local AllocPhase currentPhase = PHASE_OTHER;
+thread_local AllocCategory currentCategory = CATEGORY_OTHER;
+
+const char* phaseNames[PHASE_COUNT] = { "other", "decode", "optimize", "firstPass", "secondPass", "print" };
+const char* categoryNames[CATEGORY_COUNT] = { "other", "tokens", "regex", "operands", "symbols", "entries" };
+
+
+// Izvestaj na izlasku: staticki objekat se unistava posle main-a.
+struct ReportAtExit {
+	~ReportAtExit() {
+		AllocProfile::report(stderr);
+	}
+} reportAtExit;
+
+
+void* allocate(size_t size) {
+	AllocProfile::allocated(size);
+	void* p = malloc(size ? size : 1);
+	if (!p) {
+		throw bad_alloc();
+	}
+	return p;
+}
+
+
+void release(void* p) {
+	if (p) {
+		AllocProfile::released();
+		free(p);
+	}
+}
+
+}
+
+
+
+AllocProfile::PhaseScope::PhaseScope(AllocPhase phase) : previous(currentPhase) {
+	currentPhase = phase;
+}
+
+
+AllocProfile::PhaseScope::~PhaseScope() {
+	currentPhase = previous;
+}
+
+
+AllocProfile::CategoryScope::CategoryScope(AllocCategory category) : previous(currentCategory) {
+	currentCategory = category;
+}
+
+
+AllocProfile::CategoryScope::~CategoryScope() {
+	currentCategory = previous;
+}
+
+
+void AllocProfile::allocated(size_t size) {
+	Counter& c = counters[currentPhase][currentCategory];
+	c.count.fetch_add(1, memory_order_relaxed);
+	c.bytes.fetch_add(size, memory_order_relaxed);
+}
+
+
+void AllocProfile::released() {
+	counters[currentPhase][currentCategory].frees.fetch_add(1, memory_order_relaxed);
+}
+
+
+void AllocProfile::report(FILE* out) {
+	fprintf(out, "\nALLOCATION PROFILE\n\n");
+	fprintf(out, "%-12s%-10s%12s%14s%12s\n", "phase", "category", "allocs", "bytes", "frees");
+	fprintf(out, "%-12s%-10s%12s%14s%12s\n", "-----", "--------", "------", "-----", "-----");
+
+	unsigned long long totalCount = 0, totalBytes = 0, totalFrees = 0;
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		unsigned long long phaseCount = 0, phaseBytes = 0, phaseFrees = 0;
+		for (int c = 0; c < CATEGORY_COUNT; c++) {
+			unsigned long long count = counters[p][c].count.load(memory_order_relaxed);
+			unsigned long long bytes = counters[p][c].bytes.load(memory_order_relaxed);
+			unsigned long long frees = counters[p][c].frees.load(memory_order_relaxed);
+			if (count == 0 && frees == 0) {
+				continue;
+			}
+			fprintf(out, "%-12s%-10s%12llu%14llu%12llu\n", phaseNames[p], categoryNames[c], count, bytes, frees);
+			phaseCount += count;
+			phaseBytes += bytes;
+			phaseFrees += frees;
+		}
+		if (phaseCount > 0 || phaseFrees > 0) {
+			fprintf(out, "%-12s%-10s%12llu%14llu%12llu\n\n", phaseNames[p], "(all)", phaseCount, phaseBytes, phaseFrees);
+		}
+		totalCount += phaseCount;
+		totalBytes += phaseBytes;
+		totalFrees += phaseFrees;
+	}
+	fprintf(out, "%-12s%-10s%12llu%14llu%12llu\n", "total", "", totalCount, totalBytes, totalFrees);
+}
+
+
+
+void* operator new(size_t size) {
+	return allocate(size);
+}
+
+
+void* operator new[](size_t size) {
+	return allocate(size);
+}
+
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+	AllocProfile::allocated(size);
+	return malloc(size ? size : 1);
+}
+
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+	AllocProfile::allocated(size);
+	return malloc(size ? size : 1);
+}
+
+
+void operator delete(void* p) noexcept {
+	release(p);
+}
+
+
+void operator delete[](void* p) noexcept {
+	release(p);
+}
+
+
+void operator delete(void* p, size_t) noexcept {
+	release(p);
+}
+
+
+void operator delete[](void* p, size_t) noexcept {
+	release(p);
+}
+
+
+void operator delete(void* p, const nothrow_t&) noexcept {
+	release(p);
+}
+
+
+void operator delete[](void* p, const nothrow_t&) noexcept {
+	release(p);
+}
+
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdio>
+
+
+using namespace std;
+
+
+
+// Brojanje alokacija po fazi asemblera i po kategoriji mesta poziva.
+// Ukljucuje se samo u build-u sa -DALLOC_PROFILE (tada allocprofile.cpp zamenjuje
+// globalne operator new/delete); u obicnom build-u makroi ne generisu kod.
+// Faza i kategorija vaze za tekucu nit do kraja bloka u kome je makro naveden.
+
+enum AllocPhase { PHASE_OTHER, PHASE_DECODE, PHASE_OPTIMIZE, PHASE_FIRST_PASS, PHASE_SECOND_PASS, PHASE_PRINT, PHASE_COUNT };
+
+enum AllocCategory { CATEGORY_OTHER, CATEGORY_TOKENS, CATEGORY_REGEX, CATEGORY_OPERANDS, CATEGORY_SYMBOLS, CATEGORY_ENTRIES, CATEGORY_COUNT };
+
+
+#ifdef ALLOC_PROFILE
+
+class AllocProfile {
+public:
+	class PhaseScope {
+	private:
+		AllocPhase previous;
+	public:
+		PhaseScope(AllocPhase phase);
+		~PhaseScope();
+	};
+
+	class CategoryScope {
+	private:
+		AllocCategory previous;
+	public:
+		CategoryScope(AllocCategory category);
+		~CategoryScope();
+	};
+
+	static void allocated(size_t size);
+	static void released();
+
+	static void report(FILE* out);	// ne alocira, poziva se i na izlasku iz programa
+};
+
+
+#define ALLOC_PHASE(phase) AllocProfile::PhaseScope allocPhaseScope(phase)
+#define ALLOC_CATEGORY(category) AllocProfile::CategoryScope allocCategoryScope(category)
+
+#else
+
+#define ALLOC_PHASE(phase)
+#define ALLOC_CATEGORY(category)
+
+#endif
@@ -0,0 +1,352 @@
+#include "archive.h"
+#include "lz.h"
+
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+Archive::Archive(const string n) : name(n) {
+	fd = open(name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		fail("Error opening archive: " + name);
+		return;
+	}
+	opened = load();
+}
+
+
+Archive::~Archive() {
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+
+bool Archive::fail(const string& description) {
+	message = description;
+	return false;
+}
+
+
+// Cita zaglavlje, tabelu clanova, indeks i imena; sadrzaj clanova se cita tek na zahtev.
+bool Archive::load() {
+	char header[ARCHIVE_HEADER_SIZE];
+	if (pread(fd, header, sizeof(header), 0) != (ssize_t) sizeof(header) || memcmp(header, ARCHIVE_MAGIC, 4) != 0) {
+		return fail("Not an archive: " + name);
+	}
+	if (getLittleEndian(header + 4) != ARCHIVE_VERSION) {
+		return fail("Unsupported archive version: " + name);
+	}
+	uint32_t memberCount = getLittleEndian(header + 8);
+	slotCount = getLittleEndian(header + 12);
+	uint32_t namesSize = getLittleEndian(header + 16);
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		return fail("Error reading archive: " + name);
+	}
+	uint64_t tables = (uint64_t) memberCount * ARCHIVE_MEMBER_SIZE + (uint64_t) slotCount * ARCHIVE_SLOT_SIZE + namesSize;
+	if (slotCount == 0 || (slotCount & (slotCount - 1)) != 0 || ARCHIVE_HEADER_SIZE + tables > (uint64_t) st.st_size) {
+		return fail("Corrupt archive header: " + name);
+	}
+
+	vector<char> table(tables);
+	if (pread(fd, table.data(), table.size(), ARCHIVE_HEADER_SIZE) != (ssize_t) table.size()) {
+		return fail("Truncated archive: " + name);
+	}
+	const char* p = table.data();
+	const char* slotsStart = p + memberCount * ARCHIVE_MEMBER_SIZE;
+	slots.assign(slotsStart, slotsStart + slotCount * ARCHIVE_SLOT_SIZE);
+	names.assign(slotsStart + slots.size(), namesSize);
+
+	for (uint32_t i = 0; i < memberCount; i++, p += ARCHIVE_MEMBER_SIZE) {
+		ArchiveMember member;
+		const char* memberName = nameAt(getLittleEndian(p));
+		member.offset = getLittleEndian(p + 4);
+		member.size = getLittleEndian(p + 8);
+		if (!memberName || (uint64_t) member.offset + member.size > (uint64_t) st.st_size) {
+			return fail("Corrupt member table: " + name);
+		}
+		member.name = memberName;
+		memberTable.push_back(member);
+	}
+
+	for (uint32_t i = 0; i < slotCount; i++) {
+		const char* slot = &slots[i * ARCHIVE_SLOT_SIZE];
+		uint32_t member = getLittleEndian(slot + 8);
+		if (member != 0 && (member > memberCount || !nameAt(getLittleEndian(slot + 4)))) {
+			return fail("Corrupt symbol index: " + name);
+		}
+	}
+
+	return true;
+}
+
+
+const char* Archive::nameAt(uint32_t offset) const {
+	if (offset >= names.size() || memchr(names.data() + offset, '\0', names.size() - offset) == nullptr) {
+		return nullptr;
+	}
+	return names.data() + offset;
+}
+
+
+vector<pair<string, int>> Archive::symbols() const {
+	vector<pair<string, int>> result;
+	for (uint32_t i = 0; i < slotCount; i++) {
+		const char* slot = &slots[i * ARCHIVE_SLOT_SIZE];
+		uint32_t member = getLittleEndian(slot + 8);
+		if (member != 0) {
+			result.push_back({ nameAt(getLittleEndian(slot + 4)), (int) member - 1 });
+		}
+	}
+	return result;
+}
+
+
+// Ocekivano jedno probanje: mesto cuva ceo hes, pa se imena porede samo kada se hes poklopi.
+const ArchiveMember* Archive::find(string_view symbol, int* probes) const {
+	uint32_t h = hash(symbol);
+	uint32_t mask = slotCount - 1;
+	for (uint32_t i = h & mask, n = 0; n < slotCount; i = (i + 1) & mask, n++) {
+		const char* slot = &slots[i * ARCHIVE_SLOT_SIZE];
+		uint32_t member = getLittleEndian(slot + 8);
+		if (probes) {
+			(*probes)++;
+		}
+		if (member == 0) {
+			return nullptr;
+		}
+		if (getLittleEndian(slot) == h && symbol == nameAt(getLittleEndian(slot + 4))) {
+			return &memberTable[member - 1];
+		}
+	}
+	return nullptr;
+}
+
+
+bool Archive::read(const ArchiveMember& member, vector<char>& data) const {
+	data.resize(member.size);
+	return pread(fd, data.data(), member.size, member.offset) == (ssize_t) member.size;
+}
+
+
+uint32_t Archive::hash(string_view s) {
+	uint32_t h = 2166136261u;
+	for (char c : s) {
+		h ^= (unsigned char) c;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+
+static bool readWhole(const string& fileName, string& content) {
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	char magic[4];
+	bool ok = true;
+	if (pread(fd, magic, 4, 0) == 4 && Lz::isFrame(magic)) {	// -z
+		LzReader reader(fd);
+		char buffer[Lz::BLOCK_SIZE];
+		size_t n;
+		while ((n = reader.read(buffer, sizeof(buffer))) > 0) {
+			content.append(buffer, n);
+		}
+		ok = reader.ok();
+	}
+	else {
+		char buffer[1 << 16];
+		ssize_t n;
+		while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+			content.append(buffer, n);
+		}
+		ok = n == 0;
+	}
+	close(fd);
+	return ok;
+}
+
+
+// Objektni fajl ima tabelu simbola; u listingu je red tabele simbola: indeks, ime, (prazno),
+// sekcija, pomeraj, scope, a kraj tabele je prazan red.
+bool Archive::globalSymbols(const string& fileName, vector<string>& symbols, string& message) {
+	string content;
+	if (!readWhole(fileName, content)) {
+		message = "Error reading member: " + fileName;
+		return false;
+	}
+	if (content.compare(0, 4, string(OBJECT_MAGIC, 4)) == 0) {	// -f obj
+		ObjectFile object(fileName);
+		if (!object.isOpen()) {
+			message = object.error();
+			return false;
+		}
+		for (const LoadedSymbol& symbol : object.symbols()) {
+			if (symbol.global && symbol.section != OBJECT_UNDEFINED) {
+				symbols.push_back(symbol.name);
+			}
+		}
+		return true;
+	}
+	if (content.compare(0, 12, "SYMBOL TABLE") != 0) {
+		message = "Not a listing or object file: " + fileName;
+		return false;
+	}
+
+	istringstream is(content);
+	string line;
+	for (int i = 0; i < 4; i++) {	// naslov, prazan red, zaglavlje, crte
+		getline(is, line);
+	}
+	while (getline(is, line) && !line.empty()) {
+		vector<string> fields;
+		istringstream ls(line);
+		string field;
+		while (getline(ls, field, '\t')) {
+			if (!field.empty()) {
+				fields.push_back(field);
+			}
+		}
+		if (fields.size() != 5) {
+			message = "Bad symbol table row in " + fileName + ": " + line;
+			return false;
+		}
+		if (fields[4] == "global" && fields[2] != "?") {
+			symbols.push_back(fields[1]);
+		}
+	}
+	return true;
+}
+
+
+static bool writeAll(int fd, const char* data, size_t size) {
+	while (size > 0) {
+		ssize_t n = write(fd, data, size);
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+
+bool Archive::create(const string& fileName, const vector<string>& memberFiles, string& message) {
+	struct Input {
+		string name;	// bez putanje
+		string content;
+	};
+	vector<Input> inputs;
+	vector<pair<string, uint32_t>> globals;	// (simbol, clan)
+	unordered_map<string, uint32_t> definedIn;
+
+	for (const string& file : memberFiles) {
+		Input input;
+		size_t slash = file.find_last_of('/');
+		input.name = (slash == string::npos) ? file : file.substr(slash + 1);
+		int fd = open(file.c_str(), O_RDONLY);
+		if (fd < 0) {
+			message = "Error opening member: " + file;
+			return false;
+		}
+		char buffer[1 << 16];
+		ssize_t n;
+		while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+			input.content.append(buffer, n);
+		}
+		close(fd);
+		if (n < 0) {
+			message = "Error reading member: " + file;
+			return false;
+		}
+
+		vector<string> symbols;
+		if (!globalSymbols(file, symbols, message)) {
+			return false;
+		}
+		uint32_t member = (uint32_t) inputs.size();
+		for (const string& symbol : symbols) {
+			auto it = definedIn.find(symbol);
+			if (it != definedIn.end()) {
+				message = "Symbol " + symbol + " is defined in both " + inputs[it->second].name + " and " + input.name;
+				return false;
+			}
+			definedIn[symbol] = member;
+			globals.push_back({ symbol, member });
+		}
+		inputs.push_back(move(input));
+	}
+
+	string names;
+	vector<uint32_t> memberNames;
+	for (const Input& input : inputs) {
+		memberNames.push_back((uint32_t) names.size());
+		names += input.name;
+		names += '\0';
+	}
+
+	uint32_t slotCount = 1;
+	while (slotCount < 2 * globals.size()) {
+		slotCount *= 2;
+	}
+	vector<char> slots(slotCount * ARCHIVE_SLOT_SIZE, 0);
+	for (const auto& global : globals) {
+		uint32_t h = hash(global.first);
+		uint32_t i = h & (slotCount - 1);
+		while (getLittleEndian(&slots[i * ARCHIVE_SLOT_SIZE + 8]) != 0) {
+			i = (i + 1) & (slotCount - 1);
+		}
+		char* slot = &slots[i * ARCHIVE_SLOT_SIZE];
+		putLittleEndian(slot, h);
+		putLittleEndian(slot + 4, (uint32_t) names.size());
+		putLittleEndian(slot + 8, global.second + 1);
+		names += global.first;
+		names += '\0';
+	}
+
+	uint64_t offset = ARCHIVE_HEADER_SIZE + (uint64_t) inputs.size() * ARCHIVE_MEMBER_SIZE + slots.size() + names.size();
+	vector<char> table(inputs.size() * ARCHIVE_MEMBER_SIZE);
+	for (size_t i = 0; i < inputs.size(); i++) {
+		char* entry = &table[i * ARCHIVE_MEMBER_SIZE];
+		putLittleEndian(entry, memberNames[i]);
+		putLittleEndian(entry + 4, (uint32_t) offset);
+		putLittleEndian(entry + 8, (uint32_t) inputs[i].content.size());
+		offset += inputs[i].content.size();
+	}
+	if (offset > 0xFFFFFFFFu) {
+		message = "Archive too large (over 4 GB)";
+		return false;
+	}
+
+	char header[ARCHIVE_HEADER_SIZE];
+	memcpy(header, ARCHIVE_MAGIC, 4);
+	putLittleEndian(header + 4, ARCHIVE_VERSION);
+	putLittleEndian(header + 8, (uint32_t) inputs.size());
+	putLittleEndian(header + 12, slotCount);
+	putLittleEndian(header + 16, (uint32_t) names.size());
+
+	int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		message = "Error opening archive for writing: " + fileName;
+		return false;
+	}
+	bool ok = writeAll(fd, header, sizeof(header)) && writeAll(fd, table.data(), table.size())
+		&& writeAll(fd, slots.data(), slots.size()) && writeAll(fd, names.data(), names.size());
+	for (size_t i = 0; ok && i < inputs.size(); i++) {
+		ok = writeAll(fd, inputs[i].content.data(), inputs[i].content.size());
+	}
+	if (close(fd) != 0 || !ok) {
+		message = "Error writing archive: " + fileName;
+		return false;
+	}
+	return true;
+}
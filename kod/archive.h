@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "objectfile.h"
+
+
+using namespace std;
+
+
+
+// Arhiva izlaza asemblera (listing ili -f obj, mogu i sa -z) sa indeksom globalnih simbola, da bi
+// povezivanje uzelo samo clanove koji definisu potrebne simbole. Clan se nalazi jednim
+// pristupom hes tabeli i jednim citanjem iz fajla, bez citanja tabela simbola clanova.
+// Sva polja su little-endian.
+//
+//	zaglavlje (20 B):	magic "ESSA", verzija, broj clanova, broj mesta u indeksu (stepen dvojke), velicina tabele imena
+//	clan (12 B):	pomeraj imena u tabeli imena, pomeraj sadrzaja u fajlu, velicina
+//	mesto (12 B):	FNV-1a hes imena simbola, pomeraj imena, redni broj clana + 1 (0 je prazno mesto)
+//	tabela imena:	imena zavrsena nulom
+//	sadrzaj clanova, redom
+//
+// Indeks je popunjen najvise do pola; sudari se razresavaju linearnim probanjem.
+
+const char ARCHIVE_MAGIC[4] = { 'E', 'S', 'S', 'A' };
+const uint32_t ARCHIVE_VERSION = 1;
+const int ARCHIVE_HEADER_SIZE = 20;
+const int ARCHIVE_MEMBER_SIZE = 12;
+const int ARCHIVE_SLOT_SIZE = 12;
+
+
+struct ArchiveMember {
+	string name;
+	uint32_t offset;
+	uint32_t size;
+};
+
+
+class Archive {
+private:
+	int fd = -1;
+	bool opened = false;
+	string message;
+
+	vector<ArchiveMember> memberTable;
+	vector<char> slots;
+	uint32_t slotCount = 0;
+	string names;
+
+	bool load();
+	bool fail(const string& description);
+	const char* nameAt(uint32_t offset) const;	// nullptr ako pomeraj nije u tabeli imena
+
+public:
+	const string name;
+
+	Archive(const string n);
+	~Archive();
+
+	Archive(const Archive&) = delete;
+	Archive& operator=(const Archive&) = delete;
+
+	bool isOpen() const { return opened; }
+	const string& error() const { return message; }
+
+	const vector<ArchiveMember>& members() const { return memberTable; }
+	vector<pair<string, int>> symbols() const;	// (simbol, indeks clana), redom mesta u indeksu
+
+	const ArchiveMember* find(string_view symbol, int* probes = nullptr) const;
+	bool read(const ArchiveMember& member, vector<char>& data) const;
+
+	static uint32_t hash(string_view s);
+
+	// Globalni simboli definisani u clanu (scope global, sekcija nije ?).
+	static bool globalSymbols(const string& fileName, vector<string>& symbols, string& message);
+
+	static bool create(const string& fileName, const vector<string>& memberFiles, string& message);
+
+};
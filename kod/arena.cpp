@@ -0,0 +1,79 @@
+#include "arena.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+
+Arena::~Arena() {
+	for (Block& block : blocks) {
+		free(block.data);
+	}
+}
+
+
+// Posle reset() se prvo koriste postojeci blokovi; blok koji je premali za zahtev se preskace.
+// Novi blok je dvostruko veci od poslednjeg, pa je broj blokova logaritamski.
+void Arena::nextBlock(size_t size, size_t align) {
+	if (next) {
+		usedBefore += next - blocks[current].data;
+		current++;
+	}
+	while (current < blocks.size() && blocks[current].size < size + align) {
+		current++;
+	}
+
+	if (current >= blocks.size()) {
+		size_t blockSize = blocks.empty() ? FIRST_BLOCK_SIZE : blocks.back().size * 2;
+		while (blockSize < size + align) {
+			blockSize *= 2;
+		}
+		char* data = (char*) malloc(blockSize);
+		if (!data) {
+			throw bad_alloc();
+		}
+		blocks.push_back({ data, blockSize });
+		current = blocks.size() - 1;
+	}
+
+	next = blocks[current].data;
+	limit = next + blocks[current].size;
+}
+
+
+string_view Arena::copy(string_view text) {
+	char* p = (char*) allocate(text.size(), 1);
+	memcpy(p, text.data(), text.size());
+	return string_view(p, text.size());
+}
+
+
+void Arena::reset() {
+	peakUsage = peak();
+	current = 0;
+	usedBefore = 0;
+	if (!blocks.empty()) {
+		next = blocks[0].data;
+		limit = next + blocks[0].size;
+	}
+}
+
+
+size_t Arena::used() const {
+	return next ? usedBefore + (next - blocks[current].data) : 0;
+}
+
+
+size_t Arena::peak() const {
+	size_t now = used();
+	return (now > peakUsage) ? now : peakUsage;
+}
+
+
+size_t Arena::reserved() const {
+	size_t total = 0;
+	for (const Block& block : blocks) {
+		total += block.size;
+	}
+	return total;
+}
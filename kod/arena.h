@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+
+using namespace std;
+
+
+
+// Bump alokator za podatke jednog prevodjenja. Memorija se zauzima u blokovima koji se
+// ne oslobadjaju pojedinacno; reset() samo vraca pokazivac na pocetak prvog bloka (O(1)),
+// a blokovi ostaju za sledece prevodjenje. Nije za vise niti.
+class Arena {
+private:
+	struct Block {
+		char* data;
+		size_t size;
+	};
+	vector<Block> blocks;
+	size_t current = 0;	// indeks bloka iz kog se zauzima
+	char* next = nullptr;
+	char* limit = nullptr;
+	size_t usedBefore = 0;	// zauzeto u blokovima pre tekuceg
+	size_t peakUsage = 0;
+
+	void nextBlock(size_t size, size_t align);
+
+public:
+	static const size_t FIRST_BLOCK_SIZE = 64 * 1024;
+
+	Arena() { }
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	void* allocate(size_t size, size_t align) {
+		char* p = (char*) (((size_t) next + align - 1) & ~(align - 1));
+		if (p + size > limit || !next) {
+			nextBlock(size, align);
+			p = (char*) (((size_t) next + align - 1) & ~(align - 1));
+		}
+		next = p + size;
+		return p;
+	}
+
+	string_view copy(string_view text);	// kopija u areni, vazi do reset()
+
+	void reset();
+
+	size_t used() const;
+	size_t peak() const;	// najvise zauzeto od nastanka arene, kroz sve reset()
+	size_t reserved() const;	// ukupna velicina blokova
+
+};
+
+
+// Alokator za standardne kontejnere: deallocate ne radi nista, memorija se vraca tek sa reset().
+template <typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	Arena* arena;
+
+	ArenaAllocator(Arena& a) : arena(&a) { }
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) { }
+
+	T* allocate(size_t n) { return (T*) arena->allocate(n * sizeof(T), alignof(T)); }
+	void deallocate(T*, size_t) { }
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+
+template <typename T>
+using ArenaVector = vector<T, ArenaAllocator<T>>;
@@ -1,1026 +1,2398 @@
-#include <string>
-#include <sstream>
-#include <iostream>
-#include <iomanip>
-
-#include "assembler.h"
-#include "instruction.h"
-
-
-using namespace std;
-
-
-
-void Assembler::addSymbol(string name, Section* section, int offset, bool isGlobal) {
-	Symbol* s = findByName(name);
-	if (s != nullptr) {
-		error("Symbol " + name + " already exists in symbol table", true);
-		return;
-	}
-
-	string sectionName;
-	if (section) {
-		sectionName = section->name;
-	}
-	else {
-		sectionName = "?";
-	}
-	Symbol symbol((int) symbolTable.size(), name, sectionName, offset, isGlobal);
-	symbolTable.push_back(symbol);
-}
-
-
-Symbol* Assembler::findByName(string& name) {
-	for (Symbol& symbol : symbolTable) {
-		if (symbol.name == name) {
-			return &symbol;
-		}
-	}
-	return nullptr;
-}
-
-
-void Assembler::error(string description, bool fatal) {
-	errorList.push_back(description);
-	if (fatal) {
-		for (string& s : errorList) {
-			cout << s << endl;
-		}
-
-		int x;
-		cin >> x;
-
-		exit(1);
-	}
-}
-
-
-TokenType Assembler::parseToken(string token) {
-	TokenType ret = ILLEGAL;
-	if (token == "psw") {
-		return PSW;
-	}
-
-	for (auto& pair: Instruction::tokenRegexMap) {
-		if (pair.first == SYMBOL || pair.first == PSW) {
-			continue;
-		}
-		if (regex_match(token, pair.second)) {
-			ret = (TokenType) pair.first;
-		}
-	}
-
-	if (ret == ILLEGAL && regex_match(token, Instruction::tokenRegexMap.at(SYMBOL))) {
-		return SYMBOL;
-	}
-
-	return ret;
-}
-
-
-Operands Assembler::numberOfOperands(string instructionToken) {
-	for (auto& pair: Instruction::operandNumRegexMap) {
-		if (regex_match(instructionToken, pair.second)) {
-			return (Operands) pair.first;
-		}
-	}
-	return ERROR;
-}
-
-
-void Assembler::assemble(ifstream& ifs, ofstream& ofs, int startAddress) {
-
-	firstPass(ifs, startAddress);
-	
-	secondPass(ifs);
-
-	print(ofs);
-	
-}
-
-
-void Assembler::firstPass(ifstream& ifs, int startAddress) {
-	
-	string line;
-	Section* section = nullptr;
-	int locationCounter = 0;
-
-
-	while (getline(ifs, line)) {
-
-		if (ifs.bad()) {
-			error("Input stream error", true);
-		}
-
-		istringstream iss(line);
-		string token;
-		bool foundCommandInLine = false;	// U jednoj liniji najvise jedna komanda.
-
-		while (iss >> token) {
-
-			TokenType tokenType = parseToken(token);
-
-			if (tokenType == LABEL) {
-				string name = token.substr(0, token.size() - 1);
-				if (!section) {	// NE SME LABELA PRE SEKCIJE ?!
-					error("Label \"" + name + "\" is before any section", true);
-				}
-				addSymbol(name, section, locationCounter, false);
-			}
-			else if (tokenType == SECTION) {
-				if (section) {
-					startAddress += locationCounter;
-				}
-
-				if (token == ".text") {
-					section = Section::TEXT;
-				}
-				else if (token == ".data") {
-					section = Section::DATA;
-				}
-				else if (token == ".rodata") {
-					section = Section::RODATA;
-				}
-				else if (token == ".bss") {
-					section = Section::BSS;
-				}
-
-				if (section->checkIfFirstAppearance() == false) {	// SEKCIJA SME DA SE POJAVLJUJE SAMO JEDANPUT
-					error("Section " + section->name + " appeared more than once", true);
-				}
-				
-				section->startAddress = startAddress;
-
-				locationCounter = 0;
-
-				addSymbol(token, section, 0, false);
-			}
-			else if (tokenType == INSTRUCTION) {
-				if (section != Section::TEXT) {
-					error("Instruction(s) outside .text section: " + token, true);
-				}
-
-				int size = 2;
-				Operands op = numberOfOperands(token);
-
-				if (op == NO_OPERANDS) {
-					string newToken;
-					iss >> newToken;
-					if (newToken != "") {
-						error("Operand number/syntax error: " + token + " " + newToken, false);
-					}
-				}
-				else if (op == ONE_OPERAND) {
-					string operand;
-					iss >> operand;
-					TokenType operandType = parseToken(operand);
-					if (Instruction::isOperand(operandType)) {
-						if (Instruction::requiresFourBytes(operandType)) {
-							size = 4;
-						}
-						string newToken;
-						iss >> newToken;
-						if (newToken != "") {
-							error("Operand number/syntax error: " + token + " " + operand + " " + newToken, false);
-						}
-					}
-					else {
-						error("Operand syntax error: " + token + " " + operand, true);
-					}
-				}
-				else if (op == TWO_OPERANDS) {
-					bool fourBytesRequired = false;
-					string operand;
-					iss >> operand;
-					if (operand.back() == ',') {
-						operand.pop_back();
-					}
-					else {
-						error("No comma after operand: " + token + " " + operand, false);
-					}
-					TokenType operandType = parseToken(operand);
-					if (Instruction::isOperand(operandType)) {
-						if (Instruction::requiresFourBytes(operandType)) {
-							size = 4;
-							fourBytesRequired = true;
-						}
-						string secondOperand;
-						iss >> secondOperand;
-						operandType = parseToken(secondOperand);
-						if (Instruction::isOperand(operandType)) {
-							if (Instruction::requiresFourBytes(operandType)) {
-								if (fourBytesRequired) {
-									error("Two operands requiring two additional bytes in one instruction: " + token + " " + operand + ", " + secondOperand, true);
-								}
-								else {
-									size = 4;
-								}
-							}
-							string newToken;
-							iss >> newToken;
-							if (newToken != "") {
-								error("Operand number/syntax error: " + token + " " + operand + ", " + secondOperand + " " + newToken, false);
-							}
-						}
-						else {
-							error("(Second) operand syntax error for " + token + ": " + secondOperand, true);
-						}
-					}
-					else {
-						error("(First) operand syntax error for " + token + ": " + operand, true);
-					}
-				}
-				else {
-					error("Instruction error: " + token, false);	// sta?
-				}
-
-				locationCounter += size;
-			}
-			else if (tokenType == DIRECTIVE) {
-				if (token == ".char" || token == ".word" || token == ".long") {
-					string val;
-					iss >> val;
-					int rep = 1;
-					while (val.back() == ',') {
-						val.pop_back();
-						TokenType type = parseToken(val);
-						if (!(type == IMM || type == IMM_HEX || type == EXPRESSION)) {
-							error("Directive syntax error", true);
-						}
-						++rep;
-						iss >> val;
-					}
-
-					TokenType type = parseToken(val);
-					if (!(type == IMM || type == IMM_HEX || type == EXPRESSION)) {
-						error("Directive syntax error", true);
-					}
-
-					if (token == ".char") {
-						locationCounter += 1 * rep;
-					}
-					else if (token == ".word") {
-						locationCounter += 2 * rep;
-					}
-					else /*if (token == ".long")*/ {
-						locationCounter += 4 * rep;
-					}
-				}
-				else if (token == ".align" || token == ".skip") {
-					string val;
-					iss >> val;
-					if (val.back() == ',') {
-						val.pop_back();
-						string padding;
-						iss >> padding;
-						TokenType type = parseToken(padding);
-						if (!(type == IMM || type == IMM_HEX)) {
-							error("Directive syntax error", true);
-						}
-					}
-					TokenType type = parseToken(val);
-					if (!(type == IMM || type == IMM_HEX)) {
-						error("Directive syntax error", true);
-					}
-
-					if (token == ".skip") {
-						int bytes = stoi(val, nullptr, 0);
-						locationCounter += bytes;
-					}
-					else /*if (token == ".align")*/ {
-						int power = stoi(val, nullptr, 0);
-						// SPRECAVANJE GRESAKA?
-						int alignment = 1;
-						for (int i = 0; i < power; i++) {
-							alignment *= 2;
-						}
-						int over = locationCounter % alignment;
-						if ((alignment != 1) && (over != 0)) {
-							locationCounter += (alignment - over);
-						}
-					}
-					
-				}
-			}
-			else if (tokenType == END) {
-				return;
-			}
-
-
-			if (tokenType == SECTION || tokenType == DIRECTIVE || tokenType == INSTRUCTION) {
-				if (!foundCommandInLine) {
-					foundCommandInLine = true;
-				}
-				else {
-					error("Only one command allowed per line of code: \"" + token + "\" is breaking the rule", false);
-					break;
-				}
-			}
-			
-		}
-	}
-
-}
-
-
-void Assembler::secondPass(ifstream& ifs) {
-
-	ifs.clear();
-	ifs.seekg(0, ios::beg);
-
-
-	string line;
-	Section* section = nullptr;
-	int locationCounter = 0;
-
-	while (getline(ifs, line)) {
-
-		if (ifs.bad()) {
-			error("Input stream error", true);
-		}
-
-		istringstream iss(line);
-		string token;
-
-		while (iss >> token) {
-
-			TokenType tokenType = parseToken(token);
-
-			if (tokenType == GLOBAL) {
-				string t;
-				while (iss >> t) {
-					if (t.back() == ',') {
-						t.pop_back();
-					}
-					Symbol* s;
-					s = findByName(t);
-					if (s != nullptr) {
-						s->isGlobal = true;
-					}
-					else {
-						error(".global directive for unknown symbol", false);
-					}
-				}
-			}
-			else if (tokenType == SECTION) {
-				if (token == ".text") {
-					section = Section::TEXT;
-				}
-				else if (token == ".data") {
-					section = Section::DATA;
-				}
-				else if (token == ".rodata") {
-					section = Section::RODATA;
-				}
-				else if (token == ".bss") {
-					section = Section::BSS;
-				}
-
-				locationCounter = 0;
-
-			}
-			else if (tokenType == INSTRUCTION) {
-				Entry entry;
-				entry.offset = locationCounter;
-
-				Operands op = numberOfOperands(token);
-
-				if (op == NO_OPERANDS) {
-					processInstruction(&entry, section, token);
-				}
-				else if (op == ONE_OPERAND) {
-					string operand;
-					iss >> operand;
-					processInstruction(&entry, section, token, operand);
-				}
-				else {
-					string firstOperand, secondOperand;
-					iss >> firstOperand;
-					if (firstOperand.back() == ',') {
-						firstOperand.pop_back();
-					}
-					iss >> secondOperand;
-					processInstruction(&entry, section, token, firstOperand, secondOperand);
-				}
-
-				if (entry.size > 0) {
-					locationCounter += entry.size;
-				}
-				else {	// entry.size JE -1 U SLUCAJU DA SU DODATNA 2 BAJTA NEPOZNATA
-					locationCounter += 4;
-				}
-
-				section->addEntry(entry);
-
-			}
-			else if (tokenType == DIRECTIVE) {
-				if (token == ".skip" || token == ".align") {
-					Entry entry;
-					entry.offset = locationCounter;
-					entry.value = 0;
-
-					string num;
-					iss >> num;
-					if (num.back() == ',') {
-						num.pop_back();
-						string padding;
-						iss >> padding;
-						int value = stoi(padding, nullptr, 0);
-						value &= 0xFF;
-						for (int shl = 8; shl <= 24; shl += 8) {
-							value |= (value << shl);
-						}
-						entry.value = value;
-					}
-
-					if (token == ".skip") {
-						int bytes = stoi(num, nullptr, 0);
-						if (bytes > 0) {
-							entry.size = bytes;
-							section->addEntry(entry);
-							locationCounter += bytes;
-						}
-						else {
-							error("Bad number of bytes for .skip", false);
-						}
-					}
-					else /*if (token == ".align")*/ {
-						int power = stoi(num, nullptr, 0);
-						int alignment = 1;
-						for (int i = 0; i < power; i++) {
-							alignment *= 2;
-						}
-						int over = locationCounter % alignment;
-						if ((alignment != 1) && (over != 0)) {
-							entry.size = alignment - over;
-						}
-						else {
-							entry.size = 0;
-						}
-
-						if (entry.size != 0) {
-							section->addEntry(entry);
-							locationCounter += entry.size;
-						}
-					}
-				}
-				else if (token == ".char" || token == ".word" || token == ".long") {	
-					int size;
-					if (token == ".char") {
-						size = 1;
-					}
-					else if (token == ".word") {
-						size = 2;
-					}
-					else /*if (token == ".long")*/ {
-						size = 4;
-					}
-
-					string val;
-					iss >> val;
-					while (val.back() == ',') {
-						val.pop_back();
-						Entry entry;
-						entry.offset = locationCounter;
-						TokenType type = parseToken(val);
-						if (type == EXPRESSION) {
-							entry.value = evaluateExpression(val);
-						}
-						else {
-							entry.value = stoi(val, nullptr, 0);
-						}
-						entry.size = size;
-						section->addEntry(entry);
-						locationCounter += size;
-						iss >> val;
-					}
-					Entry entry;
-					entry.offset = locationCounter;
-					TokenType type = parseToken(val);
-					if (type == EXPRESSION) {
-						entry.value = evaluateExpression(val);
-					}
-					else {
-						entry.value = stoi(val, nullptr, 0);
-					}
-					entry.size = size;
-					section->addEntry(entry);
-					locationCounter += size;
-				}
-			}
-			else if (tokenType == END) {
-				return;
-			}
-
-		}
-	}
-}
-
-
-int Assembler::processInstruction(Entry* entry, Section* section, string instructionToken, string firstOperand, string secondOperand) {	// firstOperand i secondOperand imaju default vrednost ""
-	ConditionCode cond = Instruction::getCondition(instructionToken);
-	const string constInstTok = instructionToken;
-	
-	if (Instruction::isRet(instructionToken)) {	// ret je pseudoinstrukcija
-		instructionToken = "pop";
-		switch (cond) {
-		case EQ: {
-			instructionToken += "eq";
-			break;
-		}
-		case NE: {
-			instructionToken += "ne";
-			break;
-		}
-		case GT: {
-			instructionToken += "gt";
-			break;
-		}
-		/*
-		case AL: {
-			instructionToken += "al";
-			break;
-		}
-		*/
-		}
-		firstOperand = "r7[0]";
-	}
-	else if (Instruction::isJmp(instructionToken)) {
-		TokenType operandType = parseToken(firstOperand);
-		if (operandType == SYMBOL) {
-			instructionToken = "add";
-			switch (cond) {
-			case EQ: {
-				instructionToken += "eq";
-				break;
-			}
-			case NE: {
-				instructionToken += "ne";
-				break;
-			}
-			case GT: {
-				instructionToken += "gt";
-				break;
-			}
-			/*
-			case AL: {
-			instructionToken += "al";
-			break;
-			}
-			*/
-			}
-			Symbol* s = findByName(firstOperand);
-			int nextInstructionOffset = entry->offset + 4;
-			int displacement = s->offset - nextInstructionOffset;
-			
-			secondOperand = to_string(displacement);
-			firstOperand = "r7";
-		}
-		else /*if (operandType == IMM || operandType == IMM_HEX || operandType == VALUE || operandType == LOC || operandType == PSW
-			|| operandType == REGDIR || operandType == REGIND_DISP_IMM || operandType == REGIND_DISP_VAR)*/ {
-			instructionToken = "mov";
-			secondOperand = firstOperand;
-			firstOperand = "r7";
-		}
-	}
-	else if (!Instruction::isCall(instructionToken)) {
-		TokenType operandType = parseToken(firstOperand);
-		if (operandType == SYMBOL) {
-			firstOperand = "#" + firstOperand;	// DA BI BIO MEMDIR
-		}
-		operandType = parseToken(secondOperand);
-		if (operandType == SYMBOL) {
-			secondOperand = "#" + secondOperand;	// DA BI BIO MEMDIR
-		}
-	}
-	InstructionCode inst = Instruction::getInstruction(instructionToken);
-
-	int code = 0;
-	code |= cond;
-	code <<= 4;
-	code |= inst;
-	code <<= 5;
-
-
-	int* additionalBytes = new int[1];
-	*additionalBytes = 0;
-	int sizeBasedOnFirstOperand = 0;
-
-
-	if (firstOperand.empty()) {	// BEZ OPERANADA
-		code <<= 5;
-
-		// samo IRET
-		// RET se prevodi u pop jer je pseudoinstrukcija
-	}
-	else if (secondOperand.empty()) {	// IMA JEDAN OPERAND
-		int mask = operandToMask(entry, section, firstOperand, additionalBytes);
-
-		switch (inst) {
-		case PUSH: {
-			code <<= 5;
-			code |= mask;
-
-			break;
-		}
-		case POP: {
-			if (isImmediate(firstOperand)) {
-				error("Destination addressing mode is immediate", true);
-			}
-
-			code |= mask;
-			code <<= 5;
-
-			break;
-		}
-		case CALL: {
-			code <<= 5;
-			code |= mask;
-
-			break;
-		}
-		default: {
-			error("Instruction processing error", true);
-
-			break;
-		}
-		}
-
-
-	}
-	else {	// IMA DVA OPERANDA
-		if (isImmediate(firstOperand)) {
-			error("Destination addressing mode is immediate", true);
-		}
-		
-		int dst = operandToMask(entry, section, firstOperand, additionalBytes);
-		int* firstOperandAdditionalBytes = nullptr;	// da bi se upamtila vrednost
-		if (additionalBytes) {
-			firstOperandAdditionalBytes = new int[1];
-			*firstOperandAdditionalBytes = *additionalBytes;
-		}
-		sizeBasedOnFirstOperand = entry->size;
-		delete additionalBytes;
-		additionalBytes = new int[1];
-		*additionalBytes = 0;
-		int src = operandToMask(entry, section, secondOperand, additionalBytes);
-		if (!additionalBytes && firstOperandAdditionalBytes != nullptr) {
-			additionalBytes = new int[1];
-			*additionalBytes = *firstOperandAdditionalBytes;
-		}
-		delete firstOperandAdditionalBytes;
-
-		switch (inst) {
-		case ADD: case SUB: case MUL: case DIV: case CMP: case AND: case OR: case NOT: case TEST: case MOV: case SHL: case SHR: {
-			code |= dst;
-			code <<= 5;
-			code |= src;
-
-
-
-
-
-			break;
-		}
-		default: {
-			error("Instruction processing error for: " + constInstTok + " " + firstOperand + " " + secondOperand, true);
-
-			break;
-		}
-
-		}
-
-	}
-
-
-	if (sizeBasedOnFirstOperand == 4) {
-		entry->size = 4;
-	}
-	else if (sizeBasedOnFirstOperand == -1) {
-		entry->size = -1;
-	}
-
-	if ((entry->size == 4) && (additionalBytes != nullptr)) {
-		code <<= 16;
-		//*additionalBytes &= 0xFFFF;
-		code |= *additionalBytes;
-	}
-
-	entry->value = code;
-	delete additionalBytes;
-	return entry->size;
-}
-
-
-int Assembler::operandToMask(Entry* entry, Section* section, string operand, int*& additionalBytes) {
-	TokenType operandType = parseToken(operand);
-
-	int mask = 0;
-
-	switch (operandType) {
-	case IMM: case IMM_HEX: {
-		//mask |= 0;	// nema potrebe jer je 0
-		//mask <<= 3;	// -||-
-
-		if (operand[0] == '-') {
-			stringstream(operand) >> *additionalBytes;
-			*additionalBytes &= 0xFFFF;
-		}
-		else {
-			*additionalBytes = stoi(operand, nullptr, 0);
-		}
-
-		entry->size = 4;
-
-		break;
-	}
-	case PSW: {
-		// kao i za neposredno adresiranje:
-		//mask |= 0;
-		//mask <<= 3;
-
-		mask |= 7;
-		delete additionalBytes;
-		additionalBytes = nullptr;
-		entry->size = 2;
-
-		break;
-	}
-	case VALUE: {
-		Symbol* s = processSymbol(entry, section, operand.substr(1), R_386_32);
-
-		// kao i za neposredno adresiranje:
-		//mask |= 0;
-		//mask <<= 3;
-
-		if (s) {
-			*additionalBytes = s->offset;
-			entry->size = 4;
-		}
-		else {
-			delete additionalBytes;
-			additionalBytes = nullptr;
-			entry->size = -1;
-		}
-
-		break;
-	}
-	case MEMDIR: {
-		mask |= 2;
-		mask <<= 3;
-
-		Symbol* s = processSymbol(entry, section, operand, R_386_32);
-		if (s) {
-			*additionalBytes = s->offset;
-			entry->size = 4;
-		}
-		else {
-			delete additionalBytes;
-			additionalBytes = nullptr;
-			entry->size = -1;
-		}
-
-		break;
-	}
-	case LOC: {
-		mask |= 2;
-		mask <<= 3;
-
-		*additionalBytes = stoi(operand.substr(1), nullptr, 0);
-		entry->size = 4;
-
-		break;
-	}
-	case REGDIR: {
-		mask |= 1;
-		mask <<= 3;
-
-		int reg = stoi(operand.substr(1), nullptr, 0);
-		mask |= reg;
-
-		delete additionalBytes;
-		additionalBytes = nullptr;
-
-		entry->size = 2;
-
-		break;
-	}
-	case REGIND_DISP_IMM: {
-		mask |= 3;
-		mask <<= 3;
-
-		int reg = stoi(operand.substr(1, 1), nullptr, 0);	// broj registra
-		mask |= reg;
-
-		string immVal = operand.substr(3);	// od prve cifre nadalje
-		immVal.pop_back();	// uklanja zatvorenu uglastu zagradu
-		*additionalBytes = stoi(immVal, nullptr, 0);
-		entry->size = 4;
-
-		break;
-	}
-	case REGIND_DISP_VAR: {
-		mask |= 3;
-		mask <<= 3;
-
-		int reg = stoi(operand.substr(1, 1), nullptr, 0);	// broj registra
-		mask |= reg;
-
-		string symbol = operand.substr(3);	// od prve cifre nadalje
-		symbol.pop_back();	// uklanja zatvorenu uglastu zagradu
-		Symbol* s = processSymbol(entry, section, symbol, R_386_32);
-		if (s) {
-			*additionalBytes = s->offset;
-			entry->size = 4;
-		}
-		else {
-			delete additionalBytes;
-			additionalBytes = nullptr;
-			entry->size = -1;
-		}
-
-		break;
-	}
-	case PC_REL: {
-		// kao i registarsko indirektno sa pomerajem (r7)
-		mask |= 3;
-		mask <<= 3;
-
-		mask |= 7;	// r7 je PC registar
-
-		Symbol* s = processSymbol(entry, section, operand.substr(1), R_386_PC32);
-		if (s) {
-			*additionalBytes = s->offset;
-			entry->size = 4;
-		}
-		else {
-			delete additionalBytes;
-			additionalBytes = nullptr;
-			entry->size = -1;
-		}
-
-		break;
-	}
-	case SYMBOL: {
-		// kao PC relativno
-		mask |= 3;
-		mask <<= 3;
-
-		mask |= 7;	// r7 je PC registar
-
-		Symbol* s = processSymbol(entry, section, operand, R_386_PC32);
-		if (s) {
-			*additionalBytes = s->offset;
-			entry->size = 4;
-		}
-		else {
-			delete additionalBytes;
-			additionalBytes = nullptr;
-			entry->size = -1;
-		}
-		
-
-		break;
-	}
-	default: {
-		error("Operand processing error: " + operand, true);
-		break;
-	}
-	}
-
-
-	return mask;
-}
-
-
-Symbol* Assembler::processSymbol(Entry* entry, Section* section, string symbol, RelType relType) {
-	if (symbol[0] == '#') {
-		symbol = symbol.substr(1);
-	}
-	Symbol* s = findByName(symbol);
-	if (s) {
-		if (s->section == section->name) {
-			return s;
-		}
-		else {
-			Relocation r(section->name, entry->offset, relType, s->index);
-			relocations.push_back(r);
-
-			return nullptr;
-		}
-	}
-	else {
-		addSymbol(symbol, nullptr, -1, true);
-		int index = symbolTable.size() - 1;
-		Relocation r(section->name, entry->offset, relType, index);
-		relocations.push_back(r);
-
-		return nullptr;
-	}
-}
-
-
-bool Assembler::isImmediate(string operand) {
-	TokenType type = parseToken(operand);
-	if (type == IMM || type == IMM_HEX || type == PSW ) {	// PSW se tretira kao neposredan, ne zahteva dodatne bajtove
-		return true;
-	}
-	return false;
-}
-
-
-int Assembler::evaluateExpression(string expression) {
-	char delimiter;
-	if (expression.find('+') != string::npos) {
-		delimiter = '+';
-	}
-	else {
-		delimiter = '-';
-	}
-	
-	string firstOperand = expression.substr(0, expression.find(delimiter));
-	Symbol* s1 = findByName(firstOperand);
-	if (!s1) {
-		error("Unknown first operand: " + firstOperand + " in expression: " + expression, true);
-	}
-
-	string secondOperand = expression.substr(expression.find(delimiter) + 1);
-	int val;
-	TokenType type = parseToken(secondOperand);
-	if (type == IMM || type == IMM_HEX) {
-		val = stoi(secondOperand, nullptr, 0);
-	}
-	else if (type == SYMBOL) {
-		Symbol* s2 = findByName(secondOperand);
-		if (!s2) {
-			error("Cannot find second operand (symbol): " + secondOperand + " in expression: " + expression, true);
-		}
-		val = s2->offset;
-	}
-	else {
-		error("Unknown second operand: " + secondOperand + " in expression: " + expression, true);
-	}
-
-	return (delimiter == '+') ? (s1->offset + val) : (s1->offset - val);
-}
-
-
-void Assembler::print(ostream& ofs) {
-	ofs << "SYMBOL TABLE" << endl << endl;
-	ofs << "index" << '\t' << "name" << '\t' << '\t' << "section" << '\t' << "offset" << '\t' << "scope" << endl;
-	ofs << "-----" << '\t' << "----" << '\t' << '\t' << "-------" << '\t' << "------" << '\t' << "-----" << endl;
-	for (const Symbol& s : symbolTable) {
-		ofs << s;
-	}
-	ofs << endl << endl << endl;
-
-
-
-	printRelocationTable(ofs, Section::RODATA);
-	ofs << *(Section::RODATA);
-
-
-	printRelocationTable(ofs, Section::DATA);
-	ofs << *(Section::DATA);
-	
-
-	printRelocationTable(ofs, Section::TEXT);
-	ofs << *(Section::TEXT);
-
-	
-	printRelocationTable(ofs, Section::BSS);
-	ofs << *(Section::BSS);
-
-
-
-	ofs << "section" << '\t' << "address (hex)" << '\t' << "size" << "\t[FFFFFFFF as address means there is no section]" << endl;
-	ofs << "-------" << '\t' << "-------------" << '\t' << '\t' << "----" << endl;
-	ofs << Section::RODATA->name << '\t' << hex << Section::RODATA->startAddress << '\t' << '\t' << dec << Section::RODATA->size() << endl;
-	ofs << Section::DATA->name << '\t' << hex << Section::DATA->startAddress << '\t' << '\t' << dec << Section::DATA->size() << endl;
-	ofs << Section::TEXT->name << '\t' << hex << Section::TEXT->startAddress << '\t' << '\t' << dec << Section::TEXT->size() << endl;
-	ofs << Section::BSS->name << '\t' << hex << Section::BSS->startAddress << '\t' << '\t' << dec << Section::BSS->size() << endl;
-
-
-
-	if (errorList.size() > 0) {
-		for (string& error : errorList) {
-			cout << error << endl;
-		}
-
-		int x;
-		cin >> x;
-	}
-}
-
-
-void Assembler::printRelocationTable(ostream& ofs, const Section* s) {
-	ofs << s->name << " section relocation table" << endl << endl;
-	ofs << "offset" << '\t' << '\t' << "type" << '\t' << '\t' << "index" << endl;
-	ofs << "------" << '\t' << '\t' << "----" << '\t' << '\t' << "-----" << endl;
-	for (const Relocation& r : relocations) {
-		if (r.section == s->name) {
-			ofs << r;
-		}
-	}
-	ofs << endl << endl << endl;
-}
\ No newline at end of file
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <charconv>
+
+#include <unistd.h>
+#include <sys/uio.h>
+#include <limits.h>
+
+#include "assembler.h"
+#include "instruction.h"
+#include "peephole.h"
+#include "blocklayout.h"
+#include "allocprofile.h"
+#include "objectfile.h"
+#include "stringtable.h"
+#include "spscqueue.h"
+
+
+using namespace std;
+
+
+
+static thread_local vector<string>* lexerErrors = nullptr;	// u niti leksera (-P) greske se skupljaju odvojeno
+
+thread_local Assembler::Chunk* Assembler::currentChunk = nullptr;
+
+
+void Assembler::addSymbol(string name, Section* section, int offset, bool isGlobal) {
+	ALLOC_CATEGORY(CATEGORY_SYMBOLS);
+	Symbol* s = findByName(name);
+	if (s != nullptr) {
+		error("Symbol " + name + " already exists in symbol table", true);
+		return;
+	}
+
+	if (isdigit((unsigned char) name[0])) {	// N.k, lokalna labela
+		int index = -1;
+		for (string token : { ".text", ".data", ".rodata", ".bss" }) {
+			if (sectionFor(token) == section) {
+				index = findByName(token)->index;
+			}
+		}
+		Symbol symbol(index, arena.copy(name), section->name, offset, false);
+		localLabels.push_back(symbol);
+		localIndex[symbol.name] = (int) localLabels.size() - 1;
+		return;
+	}
+
+	string_view sectionName;
+	if (section) {
+		sectionName = section->name;
+	}
+	else {
+		sectionName = "?";
+	}
+	Symbol symbol((int) symbolTable.size(), arena.copy(name), sectionName, offset, isGlobal);
+	symbolTable.push_back(symbol);
+	symbolIndex[symbol.name] = symbol.index;
+}
+
+
+// Samo cita, pa je sme pozivati vise niti istovremeno (-j, drugi prolaz).
+Symbol* Assembler::findByName(string& name) {
+	if (!name.empty() && isdigit((unsigned char) name[0])) {
+		auto it = localIndex.find(name);
+		return (it == localIndex.end()) ? nullptr : &localLabels[it->second];
+	}
+	auto it = symbolIndex.find(name);
+	if (it == symbolIndex.end()) {
+		return nullptr;
+	}
+	return &symbolTable[it->second];
+}
+
+
+string Assembler::defineLocalLabel(const string& number) {
+	size_t digit = number.find_first_not_of('0');
+	string n = (digit == string::npos) ? "0" : number.substr(digit);
+	return n + "." + to_string(localDefinitions[n]++);
+}
+
+
+// Nf, Nb, &Nf, #Nb, $Nf, rX[Nb]: N.k poslednje definicije broja N (b) ili sledece (f).
+// Ime N.k nastaje samo ovde; napisano u izvornom kodu bi zaobislo provere definicija.
+string Assembler::localReference(const string& operand, int line) {
+	size_t begin = 0;
+	size_t end = operand.size();
+	if (!operand.empty() && (operand[0] == '&' || operand[0] == '#' || operand[0] == '$')) {
+		begin = 1;
+	}
+	else if (operand.size() > 3 && operand[0] == 'r' && operand[2] == '[' && operand.back() == ']') {
+		begin = 3;
+		end--;
+	}
+	size_t dot = operand.find('.', begin);
+	if (dot != string::npos && dot > begin && dot + 1 < end) {
+		bool internal = true;
+		for (size_t i = begin; i < end; i++) {
+			if (i != dot && !isdigit((unsigned char) operand[i])) {
+				internal = false;
+			}
+		}
+		if (internal) {
+			error("Invalid operand " + operand + " at line " + to_string(line), true);
+		}
+	}
+	if (end - begin < 2 || (operand[end - 1] != 'f' && operand[end - 1] != 'b')) {
+		return operand;
+	}
+	for (size_t i = begin; i < end - 1; i++) {
+		if (!isdigit((unsigned char) operand[i])) {
+			return operand;
+		}
+	}
+
+	string text = operand.substr(begin, end - begin);
+	size_t digit = text.find_first_not_of('0');
+	string number = (digit == end - begin - 1) ? "0" : text.substr(digit, text.size() - 1 - digit);
+	int count = localDefinitions[number];
+	int ordinal;
+	if (operand[end - 1] == 'b') {
+		if (count == 0) {
+			error("Local label " + text + " at line " + to_string(line) + " has no previous definition", true);
+		}
+		ordinal = count - 1;
+	}
+	else {
+		ordinal = count;
+		forwardReferences.push_back({ number, ordinal, text, line });
+	}
+	return operand.substr(0, begin) + number + "." + to_string(ordinal) + operand.substr(end);
+}
+
+
+void Assembler::checkForwardReferences() {
+	for (const ForwardReference& r : forwardReferences) {
+		if (r.ordinal >= localDefinitions[r.number]) {
+			error("Local label " + r.text + " at line " + to_string(r.line) + " has no following definition", true);
+		}
+	}
+}
+
+
+MappedFile* Assembler::mapFile(const string& fileName) {
+	lock_guard<mutex> lock(mappedFilesMutex);
+	auto it = mappedFiles.find(fileName);
+	if (it != mappedFiles.end()) {
+		return it->second;
+	}
+
+	MappedFile* file = new MappedFile(fileName);
+	if (!file->isOpen()) {
+		delete file;
+		error("Cannot open file for .incbin: " + fileName, true);
+	}
+	mappedFiles[fileName] = file;
+	return file;
+}
+
+
+// .incbin "fajl"[, offset[, length]]
+void Assembler::parseIncbin(const string& rest, MappedFile*& file, int& offset, int& length) {
+	size_t open = rest.find('"');
+	size_t close = (open == string::npos) ? string::npos : rest.find('"', open + 1);
+	if (close == string::npos) {
+		error("Directive syntax error: .incbin requires a quoted file name", true);
+	}
+	file = mapFile(rest.substr(open + 1, close - open - 1));
+
+	vector<int> values;
+	string params = rest.substr(close + 1);
+	size_t pos = params.find_first_not_of(" \t\r");
+	if (pos != string::npos) {
+		if (params[pos] != ',') {
+			error("Directive syntax error: .incbin " + rest, true);
+		}
+		istringstream ps(params.substr(pos + 1));
+		string field;
+		while (getline(ps, field, ',')) {
+			string val;
+			istringstream(field) >> val;
+			long long value;
+			if (!parseInteger(val, value) || val[0] == '-' || value > INT_MAX) {	// 010 nije oktalno 8, vec greska
+				error("Directive syntax error: .incbin " + rest, true);
+			}
+			values.push_back((int) value);
+		}
+	}
+	if (values.size() > 2) {
+		error("Directive syntax error: .incbin " + rest, true);
+	}
+
+	long long fileSize = (long long) file->size();
+	offset = (values.size() > 0) ? values[0] : 0;
+	long long len = (values.size() > 1) ? values[1] : fileSize - offset;
+	if (offset > fileSize || offset + len > fileSize || len > 0x7FFFFFFF) {
+		error(".incbin range out of bounds for file " + file->name, true);
+	}
+	length = (int) len;
+}
+
+
+void Assembler::error(string description, bool fatal) {
+	if (lexerErrors) {
+		lexerErrors->push_back(description);	// arena nije za vise niti
+	}
+	else if (currentChunk) {
+		currentChunk->events.push_back({ EVENT_ERROR, description, 0 });
+	}
+	else {
+		errorList.push_back(arena.copy(description));
+	}
+	if (fatal) {
+		throw AssemblerError(description);	// hvata se u assemble(), biblioteka ne sme da prekine proces
+	}
+}
+
+
+TokenType Assembler::parseToken(string token) {
+	ALLOC_CATEGORY(CATEGORY_REGEX);
+	TokenType ret = ILLEGAL;
+	if (token == "psw") {
+		return PSW;
+	}
+
+	for (auto& pair: Instruction::tokenRegexMap) {
+		if (pair.first == SYMBOL || pair.first == PSW) {
+			continue;
+		}
+		if (regex_match(token, pair.second)) {
+			ret = (TokenType) pair.first;
+		}
+	}
+
+	if (ret == ILLEGAL && regex_match(token, Instruction::tokenRegexMap.at(SYMBOL))) {
+		return SYMBOL;
+	}
+
+	return ret;
+}
+
+
+Operands Assembler::numberOfOperands(string instructionToken) {
+	ALLOC_CATEGORY(CATEGORY_REGEX);
+	for (auto& pair: Instruction::operandNumRegexMap) {
+		if (regex_match(instructionToken, pair.second)) {
+			return (Operands) pair.first;
+		}
+	}
+	return ERROR;
+}
+
+
+Assembler::Assembler(Options o) : options(o) { }
+
+
+Assembler::~Assembler() {
+	for (auto& pair : mappedFiles) {
+		delete pair.second;
+	}
+}
+
+
+// Prazni sva polja stanja; sadrzaj arene se pri tom ne cita, pa se ona vraca na pocetak na kraju.
+void Assembler::reset(const Options& o) {
+	options = o;
+	for (Section& section : sections) {
+		section.reset();
+	}
+	locationCounter = 0;
+	peepholeReport.clear();
+	encodingCache = EncodingCache();
+	statements.clear();
+	conditionals.clear();
+	layoutOrder.clear();
+	fill(begin(sectionSizes), end(sectionSizes), 0);
+	fill(begin(sectionVisits), end(sectionVisits), 0);
+	literals.clear();
+	literalValues.clear();
+	literalPool = -1;
+	symbolTable = ArenaVector<Symbol>(arena);
+	symbolIndex.clear();
+	localDefinitions.clear();
+	forwardReferences.clear();
+	localLabels = ArenaVector<Symbol>(arena);
+	localIndex.clear();
+	chunks.clear();
+	relocations = ArenaVector<Relocation>(arena);
+	errorList = ArenaVector<string_view>(arena);
+	lineTable = LineTable();
+	for (auto& pair : mappedFiles) {
+		delete pair.second;
+	}
+	mappedFiles.clear();
+	for (string& formatted : formattedSections) {
+		formatted.clear();
+	}
+	arena.reset();
+}
+
+
+Result assemble(string_view source, const Options& options) {
+	return assembleIn(make_shared<Assembler>(options), source);
+}
+
+
+Result assemble(string_view source, const Options& options, Result&& previous) {
+	shared_ptr<Assembler> context = const_pointer_cast<Assembler>(previous.context);
+	previous = Result();
+	if (context && context.use_count() == 1) {
+		context->reset(options);
+	}
+	else {	// rezultat je kopiran, kontekst jos neko koristi
+		context = make_shared<Assembler>(options);
+	}
+	return assembleIn(context, source);
+}
+
+
+Result assembleIn(shared_ptr<Assembler> context, string_view source) {
+	Result result;
+
+	try {
+		context->assemble(source);
+		result.success = true;
+	}
+	catch (AssemblerError&) {
+		// opis je vec u errorList
+	}
+	catch (logic_error& e) {	// stoi za neispravan ili preveliki broj
+		context->error(string("Invalid number: ") + e.what(), false);
+	}
+
+	result.errors.assign(context->errorList.begin(), context->errorList.end());
+	result.report = context->peepholeReport;
+	if (result.success) {
+		result.sections = Span<const Section>(context->sections, 4);
+		result.symbols = Span<const Symbol>(context->symbolTable.data(), context->symbolTable.size());
+		result.relocations = Span<const Relocation>(context->relocations.data(), context->relocations.size());
+		result.literalPool = context->literalPool;
+	}
+	result.arenaPeak = context->arena.peak();
+	result.context = context;
+	return result;
+}
+
+
+const LineTable& Result::lines() const {
+	return context->lines();
+}
+
+
+void Result::print(ostream& ofs) const {
+	context->print(ofs);
+}
+
+
+bool Result::writeFlatBinary(int fd) const {
+	return context->writeFlatBinary(fd);
+}
+
+
+bool Result::writeObject(int fd) const {
+	return context->writeObject(fd);
+}
+
+
+bool Result::writeLineProgram(const char* fileName) const {
+	return context->writeLineProgram(fileName);
+}
+
+
+void Assembler::assemble(string_view source) {
+
+	bool parallel = options.jobs > 1;
+
+	if (options.pipeline > 0 && !options.optimize && !options.layout && !parallel) {	// optimizatori rade nad celim nizom naredbi
+		pipelinedFirstPass(source);
+	}
+	else {
+		decode(source);
+
+		if (options.optimize) {
+			optimize();
+		}
+
+		if (options.layout) {
+			layoutBlocks();
+		}
+
+		if (parallel) {
+			parallelFirstPass();
+		}
+		else {
+			firstPass();
+		}
+	}
+
+	layout(options.startAddress);
+	
+	if (parallel) {
+		parallelSecondPass();
+	}
+	else {
+		secondPass();
+	}
+
+	lineTable.finalize();
+
+	if (options.cacheStats) {
+		ostringstream report;
+		encodingCache.report(report);
+		peepholeReport += report.str();
+	}
+	
+}
+
+
+// Deli ulaz na naredbe: labele, sekcije, direktive i instrukcije sa operandima (bez zareza).
+// Oba prolaza (i optimizator) rade nad ovom listom, ulaz se cita samo jednom.
+void Assembler::decode(string_view source) {
+	ALLOC_PHASE(PHASE_DECODE);
+	ALLOC_CATEGORY(CATEGORY_TOKENS);
+
+	TokenizedSource tokenized;
+	Tokenizer::tokenize(source, tokenized);
+
+	for (size_t line = 0; line < tokenized.lineCount(); line++) {
+		int lineNumber = (int) line + 1;
+
+		TokenCursor iss(source, tokenized, line);
+		string token;
+		bool foundCommandInLine = false;	// U jednoj liniji najvise jedna komanda.
+
+		while (iss.next(token)) {
+
+			TokenType tokenType = parseToken(token);
+
+			if (tokenType == ILLEGAL && token.size() > 1 && token.back() == ':' && all_of(token.begin(), token.end() - 1, ::isdigit)) {
+				tokenType = LABEL;	// numericka lokalna labela
+				token = defineLocalLabel(token.substr(0, token.size() - 1)) + ":";
+			}
+
+			if (tokenType == CONDITIONAL) {
+				string operand;
+				iss.next(operand);
+				conditional(token, operand, source, tokenized, line);
+				break;
+			}
+
+			Statement statement;
+			statement.line = lineNumber;
+			statement.type = tokenType;
+			statement.token = token;
+
+			if (tokenType == LABEL) {
+				statement.token = token.substr(0, token.size() - 1);
+			}
+			else if (tokenType == GLOBAL) {
+				string t;
+				while (iss.next(t)) {
+					if (iss.flags() & TRAILING_COMMA) {
+						t.pop_back();
+					}
+					statement.operands.push_back(t);
+				}
+			}
+			else if (tokenType == INSTRUCTION) {
+				Operands op = numberOfOperands(token);
+
+				if (op == NO_OPERANDS) {
+					string newToken;
+					iss.next(newToken);
+					if (newToken != "") {
+						error("Operand number/syntax error: " + token + " " + newToken, false);
+					}
+				}
+				else if (op == ONE_OPERAND) {
+					string operand;
+					iss.next(operand);
+					string newToken;
+					iss.next(newToken);
+					if (newToken != "") {
+						error("Operand number/syntax error: " + token + " " + operand + " " + newToken, false);
+					}
+					statement.operands.push_back(localReference(operand, lineNumber));
+				}
+				else if (op == TWO_OPERANDS) {
+					string operand;
+					iss.next(operand);
+					if (iss.flags() & TRAILING_COMMA) {
+						operand.pop_back();
+					}
+					else {
+						error("No comma after operand: " + token + " " + operand, false);
+					}
+					string secondOperand;
+					iss.next(secondOperand);
+					string newToken;
+					iss.next(newToken);
+					if (newToken != "") {
+						error("Operand number/syntax error: " + token + " " + operand + ", " + secondOperand + " " + newToken, false);
+					}
+					statement.operands.push_back(localReference(operand, lineNumber));
+					statement.operands.push_back(localReference(secondOperand, lineNumber));
+				}
+				else {
+					error("Instruction error: " + token, false);	// sta?
+				}
+			}
+			else if (tokenType == DIRECTIVE) {
+				if (token == ".char" || token == ".word" || token == ".long") {
+					string val;
+					iss.next(val);
+					while (iss.flags() & TRAILING_COMMA) {
+						val.pop_back();
+						statement.operands.push_back(val);
+						iss.next(val);
+					}
+					if (val.empty()) {
+						error("Directive syntax error", true);
+					}
+					statement.operands.push_back(val);
+				}
+				else if (token == ".align" || token == ".skip") {
+					string val;
+					iss.next(val);
+					if (val.empty()) {
+						error("Directive syntax error", true);
+					}
+					if (iss.flags() & TRAILING_COMMA) {
+						val.pop_back();
+						string padding;
+						iss.next(padding);
+						statement.operands.push_back(val);
+						statement.operands.push_back(padding);
+					}
+					else {
+						statement.operands.push_back(val);
+					}
+				}
+				else if (token == ".incbin") {
+					statement.operands.push_back(iss.rest());	// ime fajla moze da sadrzi razmake, pa se uzima ostatak linije
+				}
+			}
+			else if (tokenType != SECTION && tokenType != END) {
+				continue;
+			}
+
+			if (lexerQueue) {
+				lexerQueue->push(move(statement));
+			}
+			else {
+				statements.push_back(statement);
+			}
+
+			if (tokenType == END) {
+				if (!conditionals.empty()) {
+					error("Unterminated .if block", true);
+				}
+				checkForwardReferences();
+				return;
+			}
+
+			if (tokenType == SECTION || tokenType == DIRECTIVE || tokenType == INSTRUCTION) {
+				if (!foundCommandInLine) {
+					foundCommandInLine = true;
+				}
+				else {
+					error("Only one command allowed per line of code: \"" + token + "\" is breaking the rule", false);
+					break;
+				}
+			}
+
+		}
+	}
+
+	if (!conditionals.empty()) {
+		error("Unterminated .if block", true);
+	}
+	checkForwardReferences();
+
+}
+
+
+void Assembler::conditional(const string& directive, const string& operand, string_view source, const TokenizedSource& tokenized, size_t& line) {
+	if (directive == ".if" || directive == ".ifdef") {
+		conditionals.push_back({ false });
+		if (!evaluateCondition(directive, operand)) {
+			skipInactive(source, tokenized, line, true);
+		}
+	}
+	else if (directive == ".else") {
+		if (conditionals.empty() || conditionals.back().elseSeen) {
+			error(".else without matching .if", true);
+		}
+		conditionals.back().elseSeen = true;
+		skipInactive(source, tokenized, line, false);	// aktivna grana je upravo zavrsena
+	}
+	else /*if (directive == ".endif")*/ {
+		if (conditionals.empty()) {
+			error(".endif without matching .if", true);
+		}
+		conditionals.pop_back();
+	}
+}
+
+
+// Kao u C preprocesoru: ime koje nije zadato sa -D ima vrednost 0.
+bool Assembler::evaluateCondition(const string& directive, const string& operand) {
+	if (operand.empty()) {
+		error("Missing operand for " + directive, true);
+	}
+
+	if (directive == ".ifdef") {
+		return options.defines.count(operand) > 0;
+	}
+
+	TokenType type = parseToken(operand);
+	if (type == IMM || type == IMM_HEX) {
+		return stoi(operand, nullptr, 0) != 0;
+	}
+	if (type != SYMBOL) {
+		error("Bad condition for .if: " + operand, true);
+	}
+	auto it = options.defines.find(operand);
+	return it != options.defines.end() && it->second != 0;
+}
+
+
+// Neaktivan blok se preskace bez klasifikacije tokena i bez parseToken: gleda se samo
+// prvi token linije, i to samo ako pocinje tackom. Ugnjezdeni .if blokovi se samo broje.
+void Assembler::skipInactive(string_view source, const TokenizedSource& tokenized, size_t& line, bool stopAtElse) {
+	int depth = 0;
+
+	while (++line < tokenized.lineCount()) {
+		uint32_t first = tokenized.lines[line];
+		if (first == tokenized.lines[line + 1]) {
+			continue;
+		}
+		const Token& t = tokenized.tokens[first];
+		const char* word = source.data() + t.offset;
+		size_t length = t.length;
+		if (word[0] != '.') {
+			continue;
+		}
+
+		if ((length == 3 && memcmp(word, ".if", 3) == 0) || (length == 6 && memcmp(word, ".ifdef", 6) == 0)) {
+			depth++;
+		}
+		else if (length == 6 && memcmp(word, ".endif", 6) == 0) {
+			if (depth == 0) {
+				conditionals.pop_back();
+				return;
+			}
+			depth--;
+		}
+		else if (length == 5 && memcmp(word, ".else", 5) == 0 && depth == 0) {
+			if (!stopAtElse) {
+				error(".else without matching .if", true);
+			}
+			conditionals.back().elseSeen = true;
+			return;
+		}
+	}
+
+	error("Unterminated .if block", true);
+}
+
+
+void Assembler::optimize() {
+	ALLOC_PHASE(PHASE_OPTIMIZE);
+	Peephole peephole;
+	peephole.run(statements);
+	ostringstream report;
+	peephole.report(report);
+	peepholeReport = report.str();
+}
+
+
+// Posle peephole optimizacije, jer ona ne pravi nove skokove.
+void Assembler::layoutBlocks() {
+	ALLOC_PHASE(PHASE_OPTIMIZE);
+	BlockLayout layout;
+	string message;
+	if (!options.profile.empty() && !layout.loadProfile(options.profile, message)) {
+		error(message, true);
+	}
+	layout.run(statements);
+	ostringstream report;
+	layout.report(report);
+	peepholeReport += report.str();
+}
+
+
+void Assembler::firstPass() {
+	ALLOC_PHASE(PHASE_FIRST_PASS);
+	
+	Section* section = nullptr;
+	int locationCounter = 0;
+
+	for (const Statement& statement : statements) {
+		if (!firstPassStatement(statement, section, locationCounter)) {
+			break;
+		}
+	}
+
+	if (section) {
+		sectionSizes[section - sections] = locationCounter;
+	}
+
+}
+
+
+// -P: lekser u posebnoj niti puni red naredbi, a ova nit radi prvi prolaz nad njima cim stignu.
+// Rezultat je isti kao redom: greske leksera idu ispred gresaka prvog prolaza, a fatalna greska
+// leksera ima prednost jer do prvog prolaza redom ne bi ni doslo. Zato se red uvek prazni do kraja.
+void Assembler::pipelinedFirstPass(string_view source) {
+	SpscQueue<Statement> queue(PIPELINE_QUEUE_SIZE);
+	lexerQueue = &queue;
+
+	vector<string> decodeErrors;
+	exception_ptr decodeFailure;
+	thread lexer([&]() {
+		lexerErrors = &decodeErrors;
+		try {
+			decode(source);
+		}
+		catch (...) {
+			decodeFailure = current_exception();
+		}
+		lexerErrors = nullptr;
+		queue.close();
+	});
+
+	ALLOC_PHASE(PHASE_FIRST_PASS);
+	Section* section = nullptr;
+	int locationCounter = 0;
+	bool finished = false;
+	exception_ptr failure;
+
+	Statement statement;
+	while (queue.pop(statement)) {
+		statements.push_back(move(statement));
+		if (finished || failure) {
+			continue;
+		}
+		try {
+			finished = !firstPassStatement(statements.back(), section, locationCounter);
+		}
+		catch (...) {
+			failure = current_exception();
+		}
+	}
+
+	lexer.join();
+	lexerQueue = nullptr;
+
+	ArenaVector<string_view> passErrors(arena);
+	passErrors.swap(errorList);
+	for (const string& e : decodeErrors) {
+		errorList.push_back(arena.copy(e));
+	}
+	if (decodeFailure) {
+		rethrow_exception(decodeFailure);
+	}
+	errorList.insert(errorList.end(), passErrors.begin(), passErrors.end());
+	if (failure) {
+		rethrow_exception(failure);
+	}
+
+	if (section) {
+		sectionSizes[section - sections] = locationCounter;
+	}
+}
+
+
+// Jedna naredba prvog prolaza; false za .end.
+bool Assembler::firstPassStatement(const Statement& statement, Section*& section, int& locationCounter) {
+	const string& token = statement.token;
+	TokenType tokenType = statement.type;
+
+	if (tokenType == LABEL) {
+		const string& name = token;
+		if (!section) {	// NE SME LABELA PRE SEKCIJE ?!
+			error("Label \"" + name + "\" is before any section", true);
+		}
+		addSymbol(name, section, locationCounter, false);
+	}
+	else if (tokenType == SECTION) {
+		if (section) {
+			sectionSizes[section - sections] = locationCounter;
+		}
+
+		section = sectionFor(token);
+		sectionVisits[section - sections]++;
+
+		if (section->checkIfFirstAppearance()) {	// ponovo otvorena sekcija se nastavlja od svog kraja
+			layoutOrder.push_back(section);
+			addSymbol(token, section, 0, false);
+		}
+
+		locationCounter = sectionSizes[section - sections];
+	}
+	else if (tokenType == INSTRUCTION || tokenType == DIRECTIVE) {
+		locationCounter += statementSize(statement, section, locationCounter);
+	}
+	else if (tokenType == END) {
+		return false;
+	}
+
+	return true;
+}
+
+
+// Velicina instrukcije ili direktive u bajtovima; od pomeraja zavisi samo .align.
+int Assembler::statementSize(const Statement& statement, Section* section, int locationCounter) {
+	const string& token = statement.token;
+	const vector<string>& operands = statement.operands;
+	TokenType tokenType = statement.type;
+
+	if (tokenType == INSTRUCTION) {
+		if (section != text) {
+			error("Instruction(s) outside .text section: " + token, true);
+		}
+
+		for (const string& operand : operands) {
+			if (operand[0] == '=') {
+				addLiteral(operand);
+			}
+		}
+
+		string key = EncodingCache::key(statement);
+		int size = 2;
+		if (cache().findSize(key, size)) {
+			return size;
+		}
+
+		Operands op = numberOfOperands(token);
+
+		if (op == ONE_OPERAND) {
+			const string& operand = operands[0];
+			TokenType operandType = parseToken(operand);
+			if (Instruction::isOperand(operandType)) {
+				if (Instruction::requiresFourBytes(operandType)) {
+					size = 4;
+				}
+			}
+			else {
+				error("Operand syntax error: " + token + " " + operand, true);
+			}
+		}
+		else if (op == TWO_OPERANDS) {
+			bool fourBytesRequired = false;
+			const string& operand = operands[0];
+			TokenType operandType = parseToken(operand);
+			if (Instruction::isOperand(operandType)) {
+				if (Instruction::requiresFourBytes(operandType)) {
+					size = 4;
+					fourBytesRequired = true;
+				}
+				const string& secondOperand = operands[1];
+				operandType = parseToken(secondOperand);
+				if (Instruction::isOperand(operandType)) {
+					if (Instruction::requiresFourBytes(operandType)) {
+						if (fourBytesRequired) {
+							error("Two operands requiring two additional bytes in one instruction: " + token + " " + operand + ", " + secondOperand, true);
+						}
+						else {
+							size = 4;
+						}
+					}
+				}
+				else {
+					error("(Second) operand syntax error for " + token + ": " + secondOperand, true);
+				}
+			}
+			else {
+				error("(First) operand syntax error for " + token + ": " + operand, true);
+			}
+		}
+
+		cache().addSize(key, size);
+		return size;
+	}
+	else if (tokenType == DIRECTIVE) {
+		if (token == ".char" || token == ".word" || token == ".long") {
+			for (const string& val : operands) {
+				long long value;
+				if (parseInteger(val, value)) {	// brojevi bez regularnih izraza; oni su vecina u tabelama
+					continue;
+				}
+				TokenType type = parseToken(val);
+				if (!(type == IMM || type == EXPRESSION)) {	// IMM: broj sa vodecom nulom
+					error("Directive syntax error", true);
+				}
+			}
+			int rep = (int) operands.size();
+
+			if (token == ".char") {
+				return 1 * rep;
+			}
+			else if (token == ".word") {
+				return 2 * rep;
+			}
+			else /*if (token == ".long")*/ {
+				return 4 * rep;
+			}
+		}
+		else if (token == ".align" || token == ".skip") {
+			const string& val = operands[0];
+			if (operands.size() > 1) {
+				TokenType type = parseToken(operands[1]);
+				if (!(type == IMM || type == IMM_HEX)) {
+					error("Directive syntax error", true);
+				}
+			}
+			TokenType type = parseToken(val);
+			if (!(type == IMM || type == IMM_HEX)) {
+				error("Directive syntax error", true);
+			}
+
+			if (token == ".skip") {
+				return stoi(val, nullptr, 0);
+			}
+			else /*if (token == ".align")*/ {
+				int power = stoi(val, nullptr, 0);
+				// SPRECAVANJE GRESAKA?
+				int alignment = 1;
+				for (int i = 0; i < power; i++) {
+					alignment *= 2;
+				}
+				int over = locationCounter % alignment;
+				if ((alignment != 1) && (over != 0)) {
+					return alignment - over;
+				}
+			}
+			
+		}
+		else if (token == ".incbin") {
+			MappedFile* file;
+			int offset, length;
+			parseIncbin(operands[0], file, offset, length);
+			return length;
+		}
+	}
+
+	return 0;
+}
+
+
+// -j: deli naredbe do .end na delove jednake duzine i za svaki belezi sekciju na pocetku.
+void Assembler::splitChunks() {
+	size_t end = statements.size();
+	for (size_t i = 0; i < statements.size(); i++) {
+		if (statements[i].type == END) {
+			end = i;
+			break;
+		}
+	}
+
+	size_t count = max((size_t) 1, min((size_t) options.jobs * CHUNKS_PER_JOB, end / MIN_CHUNK_STATEMENTS));
+	chunks.clear();
+	chunks.resize(count);
+
+	Section* section = nullptr;
+	size_t begin = 0;
+	for (size_t k = 0; k < count; k++) {
+		Chunk& chunk = chunks[k];
+		chunk.begin = begin;
+		chunk.end = end * (k + 1) / count;
+		chunk.section = section;
+		for (size_t i = chunk.begin; i < chunk.end; i++) {
+			if (statements[i].type == SECTION) {
+				section = sectionFor(statements[i].token);
+			}
+		}
+		begin = chunk.end;
+	}
+}
+
+
+// Niti uzimaju sledeci neobradjen deo; fatalna greska zaustavlja samo svoj deo.
+void Assembler::runChunks(void (Assembler::*work)(Chunk&)) {
+	atomic<size_t> next(0);
+	auto worker = [this, work, &next]() {
+		size_t i;
+		while ((i = next++) < chunks.size()) {
+			Chunk& chunk = chunks[i];
+			currentChunk = &chunk;
+			try {
+				(this->*work)(chunk);
+			}
+			catch (...) {
+				chunk.failure = current_exception();
+			}
+			currentChunk = nullptr;
+		}
+	};
+
+	vector<thread> threads;
+	for (int t = 1; t < options.jobs && t < (int) chunks.size(); t++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (thread& t : threads) {
+		t.join();
+	}
+}
+
+
+// Velicine se racunaju od pocetka segmenta. Novi segment pocinje naredbom sekcije ili sa .align,
+// cije poravnanje zavisi od pomeraja, pa se zna tek pri spajanju.
+void Assembler::chunkFirstPass(Chunk& chunk) {
+	ALLOC_PHASE(PHASE_FIRST_PASS);
+
+	Section* section = chunk.section;
+	int locationCounter = 0;
+	chunk.segments.push_back({ section, false, 1, 0 });
+	chunk.events.push_back({ EVENT_SEGMENT, "", 0 });
+
+	for (size_t i = chunk.begin; i < chunk.end; i++) {
+		const Statement& statement = statements[i];
+		const string& token = statement.token;
+		TokenType tokenType = statement.type;
+
+		if (tokenType == LABEL) {
+			if (!section) {
+				error("Label \"" + token + "\" is before any section", true);
+			}
+			chunk.events.push_back({ EVENT_LABEL, token, locationCounter });
+		}
+		else if (tokenType == SECTION || (tokenType == DIRECTIVE && token == ".align")) {
+			int alignment = 1;
+			if (tokenType == SECTION) {
+				section = sectionFor(token);
+			}
+			else {
+				statementSize(statement, section, 0);	// samo provera sintakse
+				int power = stoi(statement.operands[0], nullptr, 0);
+				for (int p = 0; p < power; p++) {
+					alignment *= 2;
+				}
+			}
+			chunk.segments.back().size = locationCounter;
+			chunk.segments.push_back({ section, tokenType == SECTION, alignment, 0 });
+			chunk.events.push_back({ EVENT_SEGMENT, token, (int) chunk.segments.size() - 1 });
+			locationCounter = 0;
+		}
+		else if (tokenType == INSTRUCTION || tokenType == DIRECTIVE) {
+			locationCounter += statementSize(statement, section, locationCounter);
+		}
+	}
+
+	chunk.segments.back().size = locationCounter;
+}
+
+
+// Prefiksna suma velicina segmenata, redom delova. Labele, sekcije i greske se dodaju
+// redom kojim bi ih dodao prvi prolaz redom, pa su tabela simbola i greske iste.
+void Assembler::parallelFirstPass() {
+	splitChunks();
+	runChunks(&Assembler::chunkFirstPass);
+
+	ALLOC_PHASE(PHASE_FIRST_PASS);
+	Section* section = nullptr;
+	int locationCounter = 0;
+
+	for (Chunk& chunk : chunks) {
+		chunk.section = section;
+		chunk.locationCounter = locationCounter;
+
+		int base = 0;	// pocetak tekuceg segmenta
+		for (const Event& event : chunk.events) {
+			if (event.type == EVENT_SEGMENT) {
+				const Segment& segment = chunk.segments[event.value];
+				if (segment.start) {
+					if (section) {
+						sectionSizes[section - sections] = locationCounter;
+					}
+					section = segment.section;
+					sectionVisits[section - sections]++;
+					if (section->checkIfFirstAppearance()) {
+						layoutOrder.push_back(section);
+						addSymbol(event.text, section, 0, false);
+					}
+					locationCounter = sectionSizes[section - sections];
+					chunk.resumes.push_back(locationCounter);
+				}
+				int over = locationCounter % segment.alignment;
+				if (over != 0) {
+					locationCounter += segment.alignment - over;
+				}
+				base = locationCounter;
+				locationCounter += segment.size;
+			}
+			else if (event.type == EVENT_LABEL) {
+				addSymbol(event.text, section, base + event.value, false);
+			}
+			else if (event.type == EVENT_ERROR) {
+				errorList.push_back(arena.copy(event.text));
+			}
+		}
+		if (chunk.failure) {
+			rethrow_exception(chunk.failure);
+		}
+
+		for (int value : chunk.literals) {
+			addLiteral(value);
+		}
+
+		chunk.events.clear();
+		chunk.segments.clear();
+		chunk.literals.clear();
+	}
+
+	if (section) {
+		sectionSizes[section - sections] = locationCounter;
+	}
+}
+
+
+// Bazen literala (=konstanta) se dodaje na kraj .rodata (ako je nema, sekcija se pravi
+// posle svih ostalih), pa se sekcijama dodeljuju adrese redom pojavljivanja.
+// Sa --page-size redosled je text, rodata, data, bss i svaka sekcija pocinje na stranici.
+void Assembler::layout(int startAddress) {
+	if (!literalValues.empty()) {
+		if (rodata->checkIfFirstAppearance()) {
+			layoutOrder.push_back(rodata);
+			addSymbol(".rodata", rodata, 0, false);
+		}
+		literalPool = sectionSizes[rodata - sections];
+		sectionSizes[rodata - sections] += 4 * (int) literalValues.size();
+	}
+
+	int page = options.pageSize;
+	if (page > 0) {
+		vector<Section*> order;
+		for (Section* section : { text, rodata, data, bss }) {
+			if (find(layoutOrder.begin(), layoutOrder.end(), section) != layoutOrder.end()) {
+				order.push_back(section);
+			}
+		}
+		layoutOrder = order;
+	}
+
+	for (Section* section : layoutOrder) {
+		if (page > 0) {
+			startAddress = (startAddress + page - 1) / page * page;
+		}
+		section->startAddress = startAddress;
+		startAddress += sectionSizes[section - sections];
+	}
+}
+
+
+void Assembler::addLiteral(const string& operand) {
+	int value = (int) stoll(operand.substr(1), nullptr, 0);
+	if (currentChunk) {	// mesta u bazenu se dodeljuju redom delova
+		currentChunk->literals.push_back(value);
+	}
+	else {
+		addLiteral(value);
+	}
+}
+
+
+// Ista vrednost uvek dobija isto mesto u bazenu.
+void Assembler::addLiteral(int value) {
+	if (literals.find(value) == literals.end()) {
+		literals[value] = 4 * (int) literalValues.size();
+		literalValues.push_back(value);
+	}
+}
+
+
+// Sa -P u trecoj niti formatira listing zavrsenih sekcija dok se ostale jos kodiraju.
+void Assembler::secondPass() {
+	ALLOC_PHASE(PHASE_SECOND_PASS);
+
+	SpscQueue<FormatJob> queue(4);
+	thread formatter;
+	if (options.pipeline >= 3) {
+		formatQueue = &queue;
+		formatter = thread([this, &queue]() {
+			ALLOC_PHASE(PHASE_PRINT);
+			FormatJob job;
+			while (queue.pop(job)) {
+				ostringstream oss;
+				printSection(oss, &sections[job.section], Span<const Relocation>(job.relocations.data(), job.relocations.size()));
+				formattedSections[job.section] = oss.str();
+			}
+		});
+	}
+	struct FormatterGuard {	// i kada prolaz prekine fatalna greska
+		Assembler* assembler;
+		thread& formatter;
+		~FormatterGuard() {
+			if (formatter.joinable()) {
+				assembler->formatQueue->close();
+				formatter.join();
+			}
+			assembler->formatQueue = nullptr;
+		}
+	} guard = { this, formatter };
+
+	Section* section = nullptr;
+	int locationCounter = 0;
+
+	for (const Statement& statement : statements) {
+		if (!secondPassStatement(statement, section, locationCounter)) {
+			break;
+		}
+	}
+
+	if (section) {
+		sectionDone(section);
+	}
+
+	addLiteralPool();
+}
+
+
+// Jedna naredba drugog prolaza; false za .end.
+bool Assembler::secondPassStatement(const Statement& statement, Section*& section, int& locationCounter) {
+	const string& token = statement.token;
+	const vector<string>& operands = statement.operands;
+	TokenType tokenType = statement.type;
+
+	if ((tokenType == INSTRUCTION || (tokenType == DIRECTIVE && token != ".align")) && section && !section->nobits) {
+		(currentChunk ? currentChunk->lines : lineTable).add(section, locationCounter, statement.line);
+	}
+
+	if (tokenType == GLOBAL) {
+		if (currentChunk) {	// zavisi od nedefinisanih simbola iz prethodnih delova
+			currentChunk->events.push_back({ EVENT_GLOBAL, "", (int) (&statement - statements.data()) });
+		}
+		else {
+			global(statement);
+		}
+	}
+	else if (tokenType == SECTION) {
+		if (section) {
+			section->locationCounter = locationCounter;
+			sectionDone(section);
+		}
+
+		section = sectionFor(token);
+
+		if (currentChunk) {	// pomeraj je iz spajanja prvog prolaza; sekcije ostalih delova se ne citaju
+			locationCounter = currentChunk->resumes[currentChunk->resumed++];
+		}
+		else {
+			locationCounter = section->locationCounter;
+		}
+	}
+	else if (tokenType == INSTRUCTION) {
+		Entry entry;
+		entry.offset = locationCounter;
+
+		string key;
+		bool cacheable = EncodingCache::cacheable(statement);
+		if (cacheable) {
+			key = EncodingCache::key(statement);
+		}
+		else {
+			cache().skipped();
+		}
+
+		if (!cacheable || !cache().findEncoding(key, entry.value, entry.size)) {
+			Operands op = numberOfOperands(token);
+
+			if (op == NO_OPERANDS) {
+				processInstruction(&entry, section, token);
+			}
+			else if (op == ONE_OPERAND) {
+				processInstruction(&entry, section, token, operands[0]);
+			}
+			else {
+				processInstruction(&entry, section, token, operands[0], operands[1]);
+			}
+
+			if (cacheable) {
+				cache().addEncoding(key, entry.value, entry.size);
+			}
+		}
+
+		if (entry.size > 0) {
+			locationCounter += entry.size;
+		}
+		else {	// entry.size JE -1 U SLUCAJU DA SU DODATNA 2 BAJTA NEPOZNATA
+			locationCounter += 4;
+		}
+
+		entry.type = CODE_ENTRY;
+		addEntry(section, entry);
+
+	}
+	else if (tokenType == DIRECTIVE) {
+		if (token == ".skip" || token == ".align") {
+			Entry entry;
+			entry.offset = locationCounter;
+			entry.value = 0;
+			entry.type = FILL_ENTRY;	// jedan entry za ceo opseg, bez obzira na velicinu
+
+			const string& num = operands[0];
+			if (operands.size() > 1) {
+				int value = stoi(operands[1], nullptr, 0);
+				value &= 0xFF;
+				for (int shl = 8; shl <= 24; shl += 8) {
+					value |= (value << shl);
+				}
+				entry.value = value;
+			}
+
+			if (token == ".skip") {
+				int bytes = stoi(num, nullptr, 0);
+				if (bytes > 0) {
+					entry.size = bytes;
+					if (!addEntry(section, entry)) {
+						error("Fill pattern in " + section->name + " section ignored", false);
+					}
+					locationCounter += bytes;
+				}
+				else {
+					error("Bad number of bytes for .skip", false);
+				}
+			}
+			else /*if (token == ".align")*/ {
+				int power = stoi(num, nullptr, 0);
+				int alignment = 1;
+				for (int i = 0; i < power; i++) {
+					alignment *= 2;
+				}
+				int over = locationCounter % alignment;
+				if ((alignment != 1) && (over != 0)) {
+					entry.size = alignment - over;
+				}
+				else {
+					entry.size = 0;
+				}
+
+				if (entry.size != 0) {
+					if (!addEntry(section, entry)) {
+						error("Fill pattern in " + section->name + " section ignored", false);
+					}
+					locationCounter += entry.size;
+				}
+			}
+		}
+		else if (token == ".char" || token == ".word" || token == ".long") {
+			dataDirective(statement, section, locationCounter);
+		}
+		else if (token == ".incbin") {
+			MappedFile* file;
+			int offset, length;
+			parseIncbin(operands[0], file, offset, length);
+			if (length > 0) {
+				if (!addBlob(section, locationCounter, file->data() + offset, length)) {
+					error(".incbin data in " + section->name + " section ignored", false);
+				}
+				locationCounter += length;
+			}
+		}
+	}
+	else if (tokenType == END) {
+		return false;
+	}
+
+	return true;
+}
+
+
+// .char, .word, .long: broj se cita direktno (from_chars) i proverava prema sirini direktive,
+// a samo izraz ide preko parseToken i tabele simbola. Vrednost van opsega se skracuje, kao ranije.
+void Assembler::dataDirective(const Statement& statement, Section* section, int& locationCounter) {
+	const string& token = statement.token;
+	int size;
+	if (token == ".char") {
+		size = 1;
+	}
+	else if (token == ".word") {
+		size = 2;
+	}
+	else /*if (token == ".long")*/ {
+		size = 4;
+	}
+	long long low = -(1LL << (8 * size - 1));
+	long long high = (1LL << (8 * size)) - 1;
+
+	Entry entry;
+	entry.size = size;
+	for (const string& val : statement.operands) {
+		entry.offset = locationCounter;
+		long long value;
+		bool number = parseInteger(val, value);
+		if (!number && parseToken(val) != EXPRESSION) {	// broj sa vodecom nulom, oktalno kao u stoll
+			value = stoll(val, nullptr, 0);
+			number = true;
+		}
+		if (number) {
+			if (value < low || value > high) {
+				error("Value out of range for " + token + ": " + val, false);
+			}
+			entry.value = (int) value;
+		}
+		else {
+			entry.value = evaluateExpression(val);
+		}
+		if (!addEntry(section, entry)) {
+			error("Initialized data in " + section->name + " section ignored: " + val, false);
+		}
+		locationCounter += size;
+	}
+}
+
+
+// Isto sto i regularni izrazi za IMM (-?[0-9]+) i IMM_HEX (0x[0-9a-fA-F]+), osim decimalnog broja
+// sa vodecom nulom. Broj van opsega long long je ispravan token, pa se vraca najveca vrednost,
+// koja je van opsega svake direktive.
+bool Assembler::parseInteger(string_view token, long long& value) {
+	int base = 10;
+	size_t start = 0;
+	if (token.size() > 2 && token[0] == '0' && token[1] == 'x') {
+		base = 16;
+		start = 2;
+	}
+	else if (!token.empty() && token[0] == '-') {
+		start = 1;
+	}
+	if (start == token.size() || !isxdigit((unsigned char) token[start]) || (base == 10 && !isdigit((unsigned char) token[start]))) {
+		return false;
+	}
+	if (base == 10 && token[start] == '0' && start + 1 < token.size()) {	// stoi(..., 0) bi ga citao oktalno
+		return false;
+	}
+
+	const char* first = token.data() + (base == 16 ? start : 0);
+	const char* last = token.data() + token.size();
+	from_chars_result result = from_chars(first, last, value, base);
+	if (result.ptr != last) {
+		return false;
+	}
+	if (result.ec == errc::result_out_of_range) {
+		value = LLONG_MAX;
+	}
+	return true;
+}
+
+
+void Assembler::global(const Statement& statement) {
+	for (string t : statement.operands) {
+		Symbol* s;
+		s = findByName(t);
+		if (s != nullptr) {
+			s->isGlobal = true;
+		}
+		else {
+			error(".global directive for unknown symbol", false);
+		}
+	}
+}
+
+
+void Assembler::addLiteralPool() {
+	for (size_t i = 0; i < literalValues.size(); i++) {
+		Entry entry;
+		entry.offset = literalPool + 4 * (int) i;
+		entry.value = literalValues[i];
+		entry.size = 4;
+		rodata->addEntry(entry);
+	}
+	if (!literalValues.empty()) {
+		sectionDone(rodata, true);
+	}
+}
+
+
+// Deo pocinje sekcijom i pomerajem iz prvog prolaza, pa se kodira nezavisno od ostalih.
+void Assembler::chunkSecondPass(Chunk& chunk) {
+	ALLOC_PHASE(PHASE_SECOND_PASS);
+
+	Section* section = chunk.section;
+	int locationCounter = chunk.locationCounter;
+	for (size_t i = chunk.begin; i < chunk.end; i++) {
+		secondPassStatement(statements[i], section, locationCounter);
+	}
+}
+
+
+// Upisi delova se dodaju redom delova; nedefinisani simboli dobijaju indeks redom prvog
+// koriscenja, kao u drugom prolazu redom. Listing se formatira tek pri ispisu.
+void Assembler::parallelSecondPass() {
+	runChunks(&Assembler::chunkSecondPass);
+
+	ALLOC_PHASE(PHASE_SECOND_PASS);
+	for (Chunk& chunk : chunks) {
+		vector<int> undefined(chunk.undefined.size());
+		for (const Event& event : chunk.events) {
+			if (event.type == EVENT_UNDEFINED) {
+				string name = event.text;
+				Symbol* s = findByName(name);
+				if (s == nullptr) {	// prvi put koriscen u ovom delu
+					addSymbol(name, nullptr, -1, true);
+					s = &symbolTable.back();
+				}
+				undefined[event.value] = s->index;
+			}
+			else if (event.type == EVENT_GLOBAL) {
+				global(statements[event.value]);
+			}
+			else if (event.type == EVENT_ERROR) {
+				errorList.push_back(arena.copy(event.text));
+			}
+		}
+		if (chunk.failure) {
+			rethrow_exception(chunk.failure);
+		}
+
+		for (int i = 0; i < 4; i++) {
+			for (const Entry& entry : chunk.entries[i]) {
+				if (entry.type == BLOB_ENTRY) {
+					sections[i].addBlob(entry.offset, chunk.blobs[entry.value], entry.size);
+				}
+				else {
+					sections[i].addEntry(entry);
+				}
+			}
+		}
+		for (Relocation r : chunk.relocations) {
+			if (r.index < 0) {
+				r.index = undefined[-1 - r.index];
+			}
+			relocations.push_back(r);
+		}
+		lineTable.append(chunk.lines);
+		encodingCache.addStats(chunk.cache);
+	}
+	chunks.clear();
+
+	addLiteralPool();
+}
+
+
+// Posle poslednjeg pojavljivanja sekcija se vise ne menja, pa je formater moze citati
+// bez zakljucavanja; relokacije se kopiraju jer niz relokacija i dalje raste.
+// .rodata sa bazenom literala je gotova tek na kraju prolaza.
+void Assembler::sectionDone(Section* section, bool withLiterals) {
+	if (!formatQueue) {
+		return;
+	}
+	if (!withLiterals && --sectionVisits[section - sections] > 0) {	// sekcija ce biti ponovo otvorena
+		return;
+	}
+	if (section == rodata && !literalValues.empty() && !withLiterals) {
+		return;
+	}
+	FormatJob job;
+	job.section = (int) (section - sections);
+	for (const Relocation& r : relocations) {
+		if (r.section == section->name) {
+			job.relocations.push_back(r);
+		}
+	}
+	formatQueue->push(move(job));
+}
+
+
+int Assembler::processInstruction(Entry* entry, Section* section, string instructionToken, string firstOperand, string secondOperand) {	// firstOperand i secondOperand imaju default vrednost ""
+	ALLOC_CATEGORY(CATEGORY_OPERANDS);
+	ConditionCode cond = Instruction::getCondition(instructionToken);
+	const string constInstTok = instructionToken;
+	
+	if (Instruction::isRet(instructionToken)) {	// ret je pseudoinstrukcija
+		instructionToken = "pop";
+		switch (cond) {
+		case EQ: {
+			instructionToken += "eq";
+			break;
+		}
+		case NE: {
+			instructionToken += "ne";
+			break;
+		}
+		case GT: {
+			instructionToken += "gt";
+			break;
+		}
+		/*
+		case AL: {
+			instructionToken += "al";
+			break;
+		}
+		*/
+		}
+		firstOperand = "r7";
+	}
+	else if (Instruction::isJmp(instructionToken)) {
+		TokenType operandType = parseToken(firstOperand);
+		if (operandType == SYMBOL) {
+			instructionToken = "add";
+			switch (cond) {
+			case EQ: {
+				instructionToken += "eq";
+				break;
+			}
+			case NE: {
+				instructionToken += "ne";
+				break;
+			}
+			case GT: {
+				instructionToken += "gt";
+				break;
+			}
+			/*
+			case AL: {
+			instructionToken += "al";
+			break;
+			}
+			*/
+			}
+			Symbol* s = findByName(firstOperand);
+			if (s == nullptr || s->section == "?") {	// spoljasnji simbol nema pomeraj
+				error("Jump to undefined symbol: " + firstOperand, true);
+			}
+			int nextInstructionOffset = entry->offset + 4;
+			int displacement = s->offset - nextInstructionOffset;
+			
+			secondOperand = to_string(displacement);
+			firstOperand = "r7";
+		}
+		else /*if (operandType == IMM || operandType == IMM_HEX || operandType == VALUE || operandType == LOC || operandType == PSW
+			|| operandType == REGDIR || operandType == REGIND_DISP_IMM || operandType == REGIND_DISP_VAR)*/ {
+			instructionToken = "mov";
+			secondOperand = firstOperand;
+			firstOperand = "r7";
+		}
+	}
+	else if (!Instruction::isCall(instructionToken)) {
+		TokenType operandType = parseToken(firstOperand);
+		if (operandType == SYMBOL) {
+			firstOperand = "#" + firstOperand;	// DA BI BIO MEMDIR
+		}
+		operandType = parseToken(secondOperand);
+		if (operandType == SYMBOL) {
+			secondOperand = "#" + secondOperand;	// DA BI BIO MEMDIR
+		}
+	}
+	InstructionCode inst = Instruction::getInstruction(instructionToken);
+
+	int code = 0;
+	code |= cond;
+	code <<= 4;
+	code |= inst;
+	code <<= 5;
+
+
+	int* additionalBytes = new int[1];
+	*additionalBytes = 0;
+	int sizeBasedOnFirstOperand = 0;
+
+
+	if (firstOperand.empty()) {	// BEZ OPERANADA
+		code <<= 5;
+		entry->size = 2;
+
+		// samo IRET
+		// RET se prevodi u pop jer je pseudoinstrukcija
+	}
+	else if (secondOperand.empty()) {	// IMA JEDAN OPERAND
+		int mask = operandToMask(entry, section, firstOperand, additionalBytes);
+
+		switch (inst) {
+		case PUSH: {
+			code <<= 5;
+			code |= mask;
+
+			break;
+		}
+		case POP: {
+			if (isImmediate(firstOperand)) {
+				error("Destination addressing mode is immediate", true);
+			}
+			if (firstOperand[0] == '=') {
+				error("Literal as destination operand: " + firstOperand, true);
+			}
+
+			code |= mask;
+			code <<= 5;
+
+			break;
+		}
+		case CALL: {
+			code <<= 5;
+			code |= mask;
+
+			break;
+		}
+		default: {
+			error("Instruction processing error", true);
+
+			break;
+		}
+		}
+
+
+	}
+	else {	// IMA DVA OPERANDA
+		if (isImmediate(firstOperand)) {
+			error("Destination addressing mode is immediate", true);
+		}
+		if (firstOperand[0] == '=') {
+			error("Literal as destination operand: " + firstOperand, true);
+		}
+		
+		int dst = operandToMask(entry, section, firstOperand, additionalBytes);
+		int* firstOperandAdditionalBytes = nullptr;	// da bi se upamtila vrednost
+		if (additionalBytes) {
+			firstOperandAdditionalBytes = new int[1];
+			*firstOperandAdditionalBytes = *additionalBytes;
+		}
+		sizeBasedOnFirstOperand = entry->size;
+		delete additionalBytes;
+		additionalBytes = new int[1];
+		*additionalBytes = 0;
+		int src = operandToMask(entry, section, secondOperand, additionalBytes);
+		if (!additionalBytes && firstOperandAdditionalBytes != nullptr) {
+			additionalBytes = new int[1];
+			*additionalBytes = *firstOperandAdditionalBytes;
+		}
+		delete firstOperandAdditionalBytes;
+
+		switch (inst) {
+		case ADD: case SUB: case MUL: case DIV: case CMP: case AND: case OR: case NOT: case TEST: case MOV: case SHL: case SHR: {
+			code |= dst;
+			code <<= 5;
+			code |= src;
+
+
+
+
+
+			break;
+		}
+		default: {
+			error("Instruction processing error for: " + constInstTok + " " + firstOperand + " " + secondOperand, true);
+
+			break;
+		}
+
+		}
+
+	}
+
+
+	if (sizeBasedOnFirstOperand == 4) {
+		entry->size = 4;
+	}
+	else if (sizeBasedOnFirstOperand == -1) {
+		entry->size = -1;
+	}
+
+	if ((entry->size == 4) && (additionalBytes != nullptr)) {
+		code <<= 16;
+		//*additionalBytes &= 0xFFFF;
+		code |= *additionalBytes;
+	}
+
+	entry->value = code;
+	delete additionalBytes;
+	return entry->size;
+}
+
+
+int Assembler::operandToMask(Entry* entry, Section* section, string operand, int*& additionalBytes) {
+	TokenType operandType = parseToken(operand);
+
+	int mask = 0;
+
+	switch (operandType) {
+	case IMM: case IMM_HEX: {
+		//mask |= 0;	// nema potrebe jer je 0
+		//mask <<= 3;	// -||-
+
+		if (operand[0] == '-') {
+			stringstream(operand) >> *additionalBytes;
+			*additionalBytes &= 0xFFFF;
+		}
+		else {
+			*additionalBytes = stoi(operand, nullptr, 0);
+		}
+
+		entry->size = 4;
+
+		break;
+	}
+	case PSW: {
+		// kao i za neposredno adresiranje:
+		//mask |= 0;
+		//mask <<= 3;
+
+		mask |= 7;
+		delete additionalBytes;
+		additionalBytes = nullptr;
+		entry->size = 2;
+
+		break;
+	}
+	case VALUE: {
+		// kao i za neposredno adresiranje:
+		//mask |= 0;
+		//mask <<= 3;
+
+		int value;
+		if (processSymbol(entry, section, operand.substr(1), R_386_32, value)) {
+			*additionalBytes = value;
+			entry->size = 4;
+		}
+		else {
+			delete additionalBytes;
+			additionalBytes = nullptr;
+			entry->size = -1;
+		}
+
+		break;
+	}
+	case MEMDIR: {
+		mask |= 2;
+		mask <<= 3;
+
+		int value;
+		if (processSymbol(entry, section, operand, R_386_32, value)) {
+			*additionalBytes = value;
+			entry->size = 4;
+		}
+		else {
+			delete additionalBytes;
+			additionalBytes = nullptr;
+			entry->size = -1;
+		}
+
+		break;
+	}
+	case LITERAL: {	// memorijsko direktno, na mesto u bazenu literala
+		mask |= 2;
+		mask <<= 3;
+
+		int offset = literalPool + literals.at((int) stoll(operand.substr(1), nullptr, 0));
+		if (options.absolute) {
+			*additionalBytes = (rodata->startAddress + offset) & 0xFFFF;
+		}
+		else {	// pomeraj u .rodata je u samoj reci, relokacija je u odnosu na simbol sekcije
+			*additionalBytes = offset;
+			string name = ".rodata";
+			Relocation r(section->name, entry->offset, R_386_32, findByName(name)->index);
+			addRelocation(r);
+		}
+		entry->size = 4;
+
+		break;
+	}
+	case LOC: {
+		mask |= 2;
+		mask <<= 3;
+
+		*additionalBytes = stoi(operand.substr(1), nullptr, 0);
+		entry->size = 4;
+
+		break;
+	}
+	case REGDIR: {
+		mask |= 1;
+		mask <<= 3;
+
+		int reg = stoi(operand.substr(1), nullptr, 0);
+		mask |= reg;
+
+		delete additionalBytes;
+		additionalBytes = nullptr;
+
+		entry->size = 2;
+
+		break;
+	}
+	case REGIND_DISP_IMM: {
+		mask |= 3;
+		mask <<= 3;
+
+		int reg = stoi(operand.substr(1, 1), nullptr, 0);	// broj registra
+		mask |= reg;
+
+		string immVal = operand.substr(3);	// od prve cifre nadalje
+		immVal.pop_back();	// uklanja zatvorenu uglastu zagradu
+		*additionalBytes = stoi(immVal, nullptr, 0);
+		entry->size = 4;
+
+		break;
+	}
+	case REGIND_DISP_VAR: {
+		mask |= 3;
+		mask <<= 3;
+
+		int reg = stoi(operand.substr(1, 1), nullptr, 0);	// broj registra
+		mask |= reg;
+
+		string symbol = operand.substr(3);	// od prve cifre nadalje
+		symbol.pop_back();	// uklanja zatvorenu uglastu zagradu
+		int value;
+		if (processSymbol(entry, section, symbol, R_386_32, value)) {
+			*additionalBytes = value;
+			entry->size = 4;
+		}
+		else {
+			delete additionalBytes;
+			additionalBytes = nullptr;
+			entry->size = -1;
+		}
+
+		break;
+	}
+	case PC_REL: {
+		// kao i registarsko indirektno sa pomerajem (r7)
+		mask |= 3;
+		mask <<= 3;
+
+		mask |= 7;	// r7 je PC registar
+
+		int value;
+		if (processSymbol(entry, section, operand.substr(1), R_386_PC32, value)) {
+			*additionalBytes = value;
+			entry->size = 4;
+		}
+		else {
+			delete additionalBytes;
+			additionalBytes = nullptr;
+			entry->size = -1;
+		}
+
+		break;
+	}
+	case SYMBOL: {
+		// kao PC relativno
+		mask |= 3;
+		mask <<= 3;
+
+		mask |= 7;	// r7 je PC registar
+
+		int value;
+		if (processSymbol(entry, section, operand, R_386_PC32, value)) {
+			*additionalBytes = value;
+			entry->size = 4;
+		}
+		else {
+			delete additionalBytes;
+			additionalBytes = nullptr;
+			entry->size = -1;
+		}
+		
+
+		break;
+	}
+	default: {
+		error("Operand processing error: " + operand, true);
+		break;
+	}
+	}
+
+
+	return mask;
+}
+
+
+// Vraca true ako je vrednost poznata odmah; inace se pravi relokacija.
+// U apsolutnom rezimu (--absolute) sve sekcije vec imaju adresu iz prvog prolaza,
+// pa relokaciju dobija samo simbol koji nije definisan u ovom fajlu.
+bool Assembler::processSymbol(Entry* entry, Section* section, string symbol, RelType relType, int& value) {
+	ALLOC_CATEGORY(CATEGORY_SYMBOLS);
+	if (symbol[0] == '#') {
+		symbol = symbol.substr(1);
+	}
+	Symbol* s = findByName(symbol);
+	if (s) {
+		if (options.absolute && s->section != "?") {
+			value = findSection(s->section)->startAddress + s->offset;
+			if (relType == R_386_PC32) {
+				value -= section->startAddress + entry->offset + 4;	// PC pokazuje na kraj instrukcije
+			}
+			value &= 0xFFFF;
+			return true;
+		}
+		if (s->section == section->name) {
+			value = s->offset;
+			return true;
+		}
+		else if (isdigit((unsigned char) s->name[0])) {	// lokalna labela: pomeraj je u reci, relokacija na simbol sekcije
+			Relocation r(section->name, entry->offset, relType, s->index);
+			addRelocation(r);
+			value = s->offset;
+			return true;
+		}
+		else {
+			Relocation r(section->name, entry->offset, relType, s->index);
+			addRelocation(r);
+
+			return false;
+		}
+	}
+	else if (isdigit((unsigned char) symbol[0])) {	// lokalna labela se ne uvozi, mora biti definisana
+		error("Local label " + symbol + " is not defined", true);
+		return false;
+	}
+	else if (currentChunk) {	// indeks simbola se zna tek pri spajanju delova
+		auto it = currentChunk->undefined.find(symbol);
+		int local;
+		if (it != currentChunk->undefined.end()) {
+			local = it->second;
+		}
+		else {
+			local = (int) currentChunk->undefined.size();
+			currentChunk->undefined[symbol] = local;
+			currentChunk->events.push_back({ EVENT_UNDEFINED, symbol, local });
+		}
+		Relocation r(section->name, entry->offset, relType, -1 - local);
+		addRelocation(r);
+
+		return false;
+	}
+	else {
+		addSymbol(symbol, nullptr, -1, true);
+		int index = symbolTable.size() - 1;
+		Relocation r(section->name, entry->offset, relType, index);
+		relocations.push_back(r);
+
+		return false;
+	}
+}
+
+
+Section* Assembler::findSection(string_view name) {
+	for (Section& section : sections) {
+		if (section.name == name) {
+			return &section;
+		}
+	}
+	return nullptr;
+}
+
+
+// U niti dela (-j) upis u sekciju se odlaze do spajanja delova; rezultat je isti kao posle upisa.
+bool Assembler::addEntry(Section* section, const Entry& entry) {
+	if (currentChunk) {
+		currentChunk->entries[section - sections].push_back(entry);
+		return section->accepts(entry);
+	}
+	return section->addEntry(entry);
+}
+
+
+bool Assembler::addBlob(Section* section, int offset, const char* data, int size) {
+	if (currentChunk) {
+		Entry entry;
+		entry.offset = offset;
+		entry.value = (int) currentChunk->blobs.size();
+		entry.size = size;
+		entry.type = BLOB_ENTRY;
+		currentChunk->blobs.push_back(data);
+		currentChunk->entries[section - sections].push_back(entry);
+		return !section->nobits;
+	}
+	return section->addBlob(offset, data, size);
+}
+
+
+void Assembler::addRelocation(const Relocation& relocation) {
+	if (currentChunk) {
+		currentChunk->relocations.push_back(relocation);
+	}
+	else {
+		relocations.push_back(relocation);
+	}
+}
+
+
+Section* Assembler::sectionFor(const string& token) {
+	if (token == ".text") {
+		return text;
+	}
+	else if (token == ".data") {
+		return data;
+	}
+	else if (token == ".rodata") {
+		return rodata;
+	}
+	else /*if (token == ".bss")*/ {
+		return bss;
+	}
+}
+
+
+bool Assembler::isImmediate(string operand) {
+	TokenType type = parseToken(operand);
+	if (type == IMM || type == IMM_HEX || type == PSW ) {	// PSW se tretira kao neposredan, ne zahteva dodatne bajtove
+		return true;
+	}
+	return false;
+}
+
+
+int Assembler::evaluateExpression(string expression) {
+	char delimiter;
+	if (expression.find('+') != string::npos) {
+		delimiter = '+';
+	}
+	else {
+		delimiter = '-';
+	}
+	
+	string firstOperand = expression.substr(0, expression.find(delimiter));
+	Symbol* s1 = findByName(firstOperand);
+	if (!s1 || s1->section == "?") {
+		error("Unknown first operand: " + firstOperand + " in expression: " + expression, true);
+	}
+
+	string secondOperand = expression.substr(expression.find(delimiter) + 1);
+	int val = 0;
+	TokenType type = parseToken(secondOperand);
+	if (type == IMM || type == IMM_HEX) {
+		val = stoi(secondOperand, nullptr, 0);
+	}
+	else if (type == SYMBOL) {
+		Symbol* s2 = findByName(secondOperand);
+		if (!s2 || s2->section == "?") {
+			error("Cannot find second operand (symbol): " + secondOperand + " in expression: " + expression, true);
+		}
+		val = s2->offset;
+	}
+	else {
+		error("Unknown second operand: " + secondOperand + " in expression: " + expression, true);
+	}
+
+	return (delimiter == '+') ? (s1->offset + val) : (s1->offset - val);
+}
+
+
+void Assembler::print(ostream& ofs) const {
+	ALLOC_PHASE(PHASE_PRINT);
+	ofs << "SYMBOL TABLE" << endl << endl;
+	ofs << "index" << '\t' << "name" << '\t' << '\t' << "section" << '\t' << "offset" << '\t' << "scope" << endl;
+	ofs << "-----" << '\t' << "----" << '\t' << '\t' << "-------" << '\t' << "------" << '\t' << "-----" << endl;
+	for (const Symbol& s : symbolTable) {
+		ofs << s;
+	}
+	ofs << endl << endl << endl;
+
+
+
+	for (const Section& s : sections) {
+		const string& formatted = formattedSections[&s - sections];
+		if (!formatted.empty()) {	// vec formatirano u drugom prolazu (-P)
+			ofs << formatted;
+		}
+		else {
+			printSection(ofs, &s, Span<const Relocation>(relocations.data(), relocations.size()));
+		}
+	}
+
+
+	printLineProgram(ofs);
+
+
+
+	ofs << "section" << '\t' << "address (hex)" << '\t' << "size" << "\t[FFFFFFFF as address means there is no section]" << endl;
+	ofs << "-------" << '\t' << "-------------" << '\t' << '\t' << "----" << endl;
+	for (const Section& s : sections) {
+		ofs << s.name << '\t' << hex << s.startAddress << '\t' << '\t' << dec << s.size() << endl;
+	}
+}
+
+
+// Ispis sekcije ne zavisi od stanja toka pre nje (prva stavka je uvek na pomeraju 0),
+// pa se sekcija moze formatirati i u poseban tok.
+void Assembler::printSection(ostream& ofs, const Section* s, Span<const Relocation> table) const {
+	printRelocationTable(ofs, s, table);
+	ofs << *s;
+}
+
+
+void Assembler::printRelocationTable(ostream& ofs, const Section* s, Span<const Relocation> table) const {
+	ofs << s->name << " section relocation table" << endl << endl;
+	ofs << "offset" << '\t' << '\t' << "type" << '\t' << '\t' << "index" << endl;
+	ofs << "------" << '\t' << '\t' << "----" << '\t' << '\t' << "-----" << endl;
+	for (const Relocation& r : table) {
+		if (r.section == s->name) {
+			ofs << r;
+		}
+	}
+	ofs << endl << endl << endl;
+}
+
+
+void Assembler::printLineProgram(ostream& ofs) const {
+	const vector<unsigned char>& program = lineTable.program();
+	ofs << "LINE PROGRAM" << '\t' << dec << lineTable.rowCount() << " rows, " << program.size() << " bytes" << endl << endl;
+	for (size_t i = 0; i < program.size(); i++) {
+		ofs << hex << uppercase << setw(2) << setfill('0') << (int) program[i] << ((i % 16 == 15) ? '\n' : ' ');
+	}
+	if (program.size() % 16 != 0) {
+		ofs << endl;
+	}
+	ofs << dec << endl << endl << endl;
+}
+
+
+bool Assembler::writeLineProgram(const char* fileName) const {
+	ALLOC_PHASE(PHASE_PRINT);
+	ofstream lfs(fileName, ios::binary);
+	if (!lfs) {
+		return false;
+	}
+	const vector<unsigned char>& program = lineTable.program();
+	lfs.write((const char*) program.data(), program.size());
+	return (bool) lfs;
+}
+
+
+// Upisuje delove slike sekcije od zadatog pomeraja u fajlu (pwritev, bez spajanja delova).
+static bool writeParts(int fd, const vector<ImagePart>& parts, off_t offset) {
+	vector<iovec> iov;
+	for (const ImagePart& part : parts) {
+		iov.push_back({ (void*) part.data, (size_t) part.size });
+	}
+
+	size_t i = 0;
+	while (i < iov.size()) {
+		int count = (int) min(iov.size() - i, (size_t) IOV_MAX);
+		ssize_t written = pwritev(fd, &iov[i], count, offset);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		offset += written;
+		while (written > 0) {	// delimican upis: nastavlja se od prvog neupisanog bajta
+			if ((size_t) written >= iov[i].iov_len) {
+				written -= iov[i].iov_len;
+				i++;
+			}
+			else {
+				iov[i].iov_base = (char*) iov[i].iov_base + written;
+				iov[i].iov_len -= written;
+				written = 0;
+			}
+		}
+	}
+	return true;
+}
+
+
+// Ravna slika: svaka sekcija na (startAddress - options.startAddress) u fajlu, jedan pwritev po sekciji.
+bool Assembler::writeFlatBinary(int fd) const {
+	ALLOC_PHASE(PHASE_PRINT);
+	off_t imageSize = 0;
+
+	for (const Section& s : sections) {
+		if (s.startAddress < 0 || s.nobits) {
+			continue;
+		}
+
+		vector<char> buffer;
+		vector<ImagePart> parts;
+		s.image(buffer, parts);
+
+		off_t offset = s.startAddress - options.startAddress;
+		imageSize = max(imageSize, offset + s.size());
+
+		if (!writeParts(fd, parts, offset)) {
+			return false;
+		}
+	}
+
+	return ftruncate(fd, imageSize) == 0;
+}
+
+
+// -f obj: sekcije redom rasporeda, svaka na pomeraju poravnatom na stranicu, pa relokacije, simboli i imena (vidi objectfile.h).
+bool Assembler::writeObject(int fd) const {
+	ALLOC_PHASE(PHASE_PRINT);
+	off_t page = (options.pageSize > 0) ? options.pageSize : DEFAULT_PAGE_SIZE;
+
+	vector<char> header(OBJECT_HEADER_SIZE + OBJECT_SECTION_SIZE * layoutOrder.size(), 0);
+	memcpy(header.data(), OBJECT_MAGIC, 4);
+	putLittleEndian(&header[4], OBJECT_VERSION);
+	putLittleEndian(&header[8], (uint32_t) page);
+	putLittleEndian(&header[12], (uint32_t) layoutOrder.size());
+
+	off_t offset = (header.size() + page - 1) / page * page;
+	off_t imageSize = header.size();
+	for (size_t i = 0; i < layoutOrder.size(); i++) {
+		const Section* s = layoutOrder[i];
+		uint32_t flags = SECTION_READ;
+		if (s == text) {
+			flags |= SECTION_EXEC;
+		}
+		else if (s == data || s == bss) {
+			flags |= SECTION_WRITE;
+		}
+		if (s->nobits) {
+			flags |= SECTION_NOBITS;
+		}
+
+		char* entry = &header[OBJECT_HEADER_SIZE + OBJECT_SECTION_SIZE * i];
+		strncpy(entry, s->name.c_str(), 8);
+		putLittleEndian(entry + 8, s->startAddress);
+		putLittleEndian(entry + 12, s->size());
+		putLittleEndian(entry + 20, flags);
+
+		if (s->nobits || s->size() == 0) {
+			continue;
+		}
+		putLittleEndian(entry + 16, (uint32_t) offset);
+
+		vector<char> buffer;
+		vector<ImagePart> parts;
+		s->image(buffer, parts);
+		if (!writeParts(fd, parts, offset)) {
+			return false;
+		}
+		imageSize = offset + s->size();
+		offset = (imageSize + page - 1) / page * page;
+	}
+
+	auto sectionIndex = [&](string_view name) {
+		for (size_t i = 0; i < layoutOrder.size(); i++) {
+			if (layoutOrder[i]->name == name) {
+				return (uint32_t) i;
+			}
+		}
+		return OBJECT_UNDEFINED;
+	};
+
+	vector<char> tables[OBJECT_TABLES];
+
+	vector<LoadedRelocation> list;
+	for (const Relocation& r : relocations) {
+		list.push_back({ sectionIndex(r.section), (uint32_t) r.offset, (uint32_t) r.relType, (uint32_t) r.index });
+	}
+	if (!list.empty() && !RelocationTable::build(list, options.compactRelocations, tables[TABLE_RELOCATIONS])) {
+		return false;
+	}
+
+	StringTable names;
+	for (const Symbol& symbol : symbolTable) {
+		names.add(symbol.name);
+	}
+	names.finish();
+	tables[TABLE_STRINGS].assign(names.data().begin(), names.data().end());
+
+	tables[TABLE_SYMBOLS].resize(symbolTable.size() * OBJECT_SYMBOL_SIZE);
+	for (size_t i = 0; i < symbolTable.size(); i++) {
+		const Symbol& symbol = symbolTable[i];
+		char* entry = &tables[TABLE_SYMBOLS][i * OBJECT_SYMBOL_SIZE];
+		bool defined = symbol.section != "?";
+		uint32_t section = defined ? sectionIndex(symbol.section) : OBJECT_UNDEFINED;
+		uint32_t flags = symbol.isGlobal ? (uint32_t) SYMBOL_GLOBAL : 0;
+		putLittleEndian(entry, names.offset(symbol.name));
+		putLittleEndian(entry + 4, section);
+		putLittleEndian(entry + 8, defined ? (uint32_t) symbol.offset : 0);
+		putLittleEndian(entry + 12, flags);
+	}
+
+	for (int k = 0; k < OBJECT_TABLES; k++) {
+		if (tables[k].empty()) {
+			continue;
+		}
+		off_t tableOffset = (imageSize + 3) / 4 * 4;
+		putLittleEndian(&header[16 + 8 * k], (uint32_t) tableOffset);
+		putLittleEndian(&header[20 + 8 * k], (uint32_t) tables[k].size());
+		if (pwrite(fd, tables[k].data(), tables[k].size(), tableOffset) != (ssize_t) tables[k].size()) {
+			return false;
+		}
+		imageSize = tableOffset + tables[k].size();
+	}
+
+	if (pwrite(fd, header.data(), header.size(), 0) != (ssize_t) header.size()) {
+		return false;
+	}
+	return ftruncate(fd, imageSize) == 0;
+}
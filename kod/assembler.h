@@ -1,49 +1,302 @@
-#pragma once
-
-#include <fstream>
-#include <string>
-#include <vector>
-
-#include "instruction.h"
-#include "symbol.h"
-#include "relocation.h"
-
-
-using namespace std;
-
-
-
-class Assembler {
-public:
-	
-	void assemble(ifstream& ifs, ofstream& ofs, int startAddress);
-
-private:
-
-	int locationCounter = 0;
-
-	void firstPass(ifstream& ifs, int startAddress);
-	void secondPass(ifstream& ifs);
-
-	TokenType parseToken(string token);
-	Operands numberOfOperands(string instructionToken);
-
-	vector<Symbol> symbolTable;
-	void addSymbol(string name, Section* section, int offset, bool isGlobal);
-	Symbol* findByName(string& name);
-
-	vector<Relocation> relocations;
-
-	vector<string> errorList;
-	void error(string description, bool fatal);
-
-	int processInstruction(Entry* entry, Section* section, string instructionToken, string firstOperand = "", string secondOperand = "");
-	int operandToMask(Entry* entry, Section* section, string operand, int*& additionalBytes);
-	Symbol* processSymbol(Entry* entry, Section* section, string symbol, RelType relType);
-	bool isImmediate(string operand);
-	int evaluateExpression(string expression);
-
-	void print(ostream& ofs);
-	void printRelocationTable(ostream& ofs, const Section* s);
-	
-};
\ No newline at end of file
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <mutex>
+#include <exception>
+
+#include "instruction.h"
+#include "symbol.h"
+#include "relocation.h"
+#include "mappedfile.h"
+#include "linetable.h"
+#include "statement.h"
+#include "tokenizer.h"
+#include "spscqueue.h"
+#include "arena.h"
+#include "encodingcache.h"
+
+
+using namespace std;
+
+
+
+struct Options {
+	int startAddress = 0;
+	bool optimize = false;	// -O: peephole optimizacija
+	bool layout = false;	// --layout: raspored osnovnih blokova u .text
+	string profile;	// --profile: broj prolaza po ivicama grafa toka, za --layout
+	bool absolute = false;	// --absolute: reference na definisane simbole se razresavaju odmah
+	int pageSize = 0;	// --page-size: sekcije poravnate na stranicu, redom text, rodata, data, bss
+	unordered_map<string, int> defines;	// -D ime[=vrednost], za .if/.ifdef
+	int pipeline = 0;	// -P: broj niti; 2: lekser uz prvi prolaz, 3: i formatiranje listinga uz drugi prolaz
+	int jobs = 0;	// -j: broj niti za prvi i drugi prolaz; 0 i 1 rade redom
+	bool cacheStats = false;	// --cache-stats: izvestaj kesa kodiranja instrukcija
+	bool compactRelocations = false;	// --relr: relokacije u -f obj kao adrese i bitmape (vidi relocationtable.h)
+};
+
+
+// Pogled na niz u memoriji jednog prevodjenja (kao std::span).
+template <typename T>
+class Span {
+private:
+	T* first = nullptr;
+	size_t count = 0;
+
+public:
+	Span() { }
+	Span(T* f, size_t c) : first(f), count(c) { }
+
+	T* begin() const { return first; }
+	T* end() const { return first + count; }
+	T& operator[](size_t i) const { return first[i]; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+};
+
+
+class Assembler;
+
+
+// Rezultat prevodjenja. Spanovi pokazuju u memoriju koju drzi context,
+// pa vaze dok postoji bar jedna kopija rezultata.
+struct Result {
+	bool success = false;
+	vector<string> errors;	// fatalna greska je poslednja; neuspeh i bez nje znaci da izlaz ne postoji
+	string report;	// izvestaj optimizatora (-O, --layout)
+
+	Span<const Section> sections;	// RODATA, DATA, TEXT, BSS
+	Span<const Symbol> symbols;
+	Span<const Relocation> relocations;
+	int literalPool = -1;	// pomeraj bazena literala u RODATA (bazen traje do kraja sekcije), -1 ako ga nema
+	size_t arenaPeak = 0;	// najvise zauzeto u areni konteksta, kroz sva prevodjenja tim kontekstom
+
+	shared_ptr<const Assembler> context;
+
+	const LineTable& lines() const;
+	void print(ostream& ofs) const;
+	bool writeFlatBinary(int fd) const;
+	bool writeObject(int fd) const;
+	bool writeLineProgram(const char* fileName) const;
+};
+
+
+// Ulazna tacka biblioteke. Nema globalnog promenljivog stanja, pa se moze
+// pozivati istovremeno iz vise niti.
+Result assemble(string_view source, const Options& options);
+
+// Za mnogo malih jedinica u jednom procesu: kontekst rezultata previous (ako ga niko drugi
+// ne drzi) se ponovo koristi, a njegova arena se vraca na pocetak u O(1) umesto da se memorija
+// oslobadja i ponovo zauzima. previous posle poziva ne vazi.
+Result assemble(string_view source, const Options& options, Result&& previous);
+
+
+class AssemblerError : public runtime_error {
+public:
+	AssemblerError(const string& description) : runtime_error(description) { }
+};
+
+
+// Stanje jednog prevodjenja.
+class Assembler {
+public:
+
+	Assembler(Options o = Options());
+	~Assembler();
+
+	Assembler(const Assembler&) = delete;
+	Assembler& operator=(const Assembler&) = delete;
+	
+	void assemble(string_view source);
+
+	const LineTable& lines() const { return lineTable; }
+	bool writeLineProgram(const char* fileName) const;
+
+	void print(ostream& ofs) const;
+	bool writeFlatBinary(int fd) const;
+	bool writeObject(int fd) const;
+
+	static const int DEFAULT_PAGE_SIZE = 4096;	// poravnanje sekcija u -f obj bez --page-size
+
+	static TokenType parseToken(string token);
+	static bool parseInteger(string_view token, long long& value);	// IMM ili IMM_HEX bez regularnih izraza
+	static Operands numberOfOperands(string instructionToken);
+
+private:
+
+	friend Result assemble(string_view source, const Options& options, Result&& previous);
+	friend Result assembleIn(shared_ptr<Assembler> context, string_view source);
+
+	Options options;
+
+	// Imena simbola, sadrzaj sekcija, relokacije i greske; mora biti pre svega sto je u njoj.
+	Arena arena;
+
+	void reset(const Options& o);	// za ponovno prevodjenje istim kontekstom
+
+	Section sections[4] = { Section("RODATA", arena), Section("DATA", arena), Section("TEXT", arena), Section("BSS", arena, true) };	// redosled ispisa
+	Section* const rodata = &sections[0];
+	Section* const data = &sections[1];
+	Section* const text = &sections[2];
+	Section* const bss = &sections[3];
+
+	int locationCounter = 0;
+
+	string peepholeReport;
+
+	EncodingCache encodingCache;
+	EncodingCache& cache() { return currentChunk ? currentChunk->cache : encodingCache; }
+
+	vector<Statement> statements;
+	void decode(string_view source);
+
+	static const int PIPELINE_QUEUE_SIZE = 1024;
+	SpscQueue<Statement>* lexerQueue = nullptr;	// -P: decode salje naredbe prvom prolazu u drugoj niti
+	void pipelinedFirstPass(string_view source);
+
+	struct Conditional {
+		bool elseSeen;
+	};
+	vector<Conditional> conditionals;	// otvoreni .if blokovi
+	void conditional(const string& directive, const string& operand, string_view source, const TokenizedSource& tokenized, size_t& line);
+	bool evaluateCondition(const string& directive, const string& operand);
+	void skipInactive(string_view source, const TokenizedSource& tokenized, size_t& line, bool stopAtElse);
+
+	void optimize();
+	void layoutBlocks();
+
+	void firstPass();
+	bool firstPassStatement(const Statement& statement, Section*& section, int& locationCounter);
+	int statementSize(const Statement& statement, Section* section, int locationCounter);
+	void layout(int startAddress);
+	void secondPass();
+	bool secondPassStatement(const Statement& statement, Section*& section, int& locationCounter);
+	void global(const Statement& statement);
+	void addLiteralPool();
+	void dataDirective(const Statement& statement, Section* section, int& locationCounter);
+
+	// -j: naredbe se dele na delove koje niti obradjuju nezavisno, a rezultati delova se spajaju redom.
+	// Pocetak dela (sekcija i pomeraj) se zna tek kada se saberu velicine prethodnih delova.
+	static const int CHUNKS_PER_JOB = 4;
+	static const size_t MIN_CHUNK_STATEMENTS = 1024;
+
+	struct Segment {	// deo bez promene sekcije i bez .align osim na pocetku
+		Section* section;
+		bool start;	// pocinje naredbom sekcije
+		int alignment;	// .align na pocetku, 1 ako ga nema
+		int size;	// od pocetka segmenta, posle poravnanja
+	};
+
+	enum EventType { EVENT_ERROR, EVENT_SEGMENT, EVENT_LABEL, EVENT_UNDEFINED, EVENT_GLOBAL };
+
+	struct Event {	// ono sto zavisi od prethodnih delova ili menja zajednicko stanje, redom naredbi
+		EventType type;
+		string text;	// poruka, ime sekcije, labela ili simbol
+		int value;	// SEGMENT: indeks segmenta, LABEL: pomeraj u segmentu, UNDEFINED: redni broj u delu, GLOBAL: indeks naredbe
+	};
+
+	struct Chunk {
+		size_t begin = 0;
+		size_t end = 0;
+		Section* section = nullptr;	// na pocetku dela
+		int locationCounter = 0;	// na pocetku dela, posle prvog prolaza
+
+		vector<Event> events;
+		exception_ptr failure;	// fatalna greska je poslednji dogadjaj
+
+		vector<Segment> segments;	// prvi prolaz
+		vector<int> resumes;	// za svaku naredbu sekcije u delu, pomeraj na kome se sekcija nastavlja
+		size_t resumed = 0;	// drugi prolaz: iskorisceni pomeraji iz resumes
+		vector<int> literals;
+
+		vector<Entry> entries[4];	// drugi prolaz: upisi u sekcije, redom
+		vector<const char*> blobs;
+		vector<Relocation> relocations;	// indeks simbola < 0: -1 - redni broj nedefinisanog simbola u delu
+		unordered_map<string, int> undefined;
+		LineTable lines;
+
+		EncodingCache cache;	// za oba prolaza dela
+	};
+
+	vector<Chunk> chunks;
+	static thread_local Chunk* currentChunk;
+
+	void splitChunks();
+	void runChunks(void (Assembler::*work)(Chunk&));
+	void chunkFirstPass(Chunk& chunk);
+	void chunkSecondPass(Chunk& chunk);
+	void parallelFirstPass();
+	void parallelSecondPass();
+	Section* sectionFor(const string& token);
+
+	vector<Section*> layoutOrder;	// redosled pojavljivanja sekcija
+	int sectionSizes[4] = { 0, 0, 0, 0 };	// velicine iz prvog prolaza; u prvom prolazu i pomeraj na kome se sekcija nastavlja
+	int sectionVisits[4] = { 0, 0, 0, 0 };	// broj pojavljivanja sekcije; -P formatira sekciju posle poslednjeg
+
+	unordered_map<int, int> literals;	// vrednost -> pomeraj u bazenu
+	vector<int> literalValues;	// redosled mesta u bazenu
+	int literalPool = -1;	// pocetak bazena u .rodata
+	void addLiteral(const string& operand);
+	void addLiteral(int value);
+
+	ArenaVector<Symbol> symbolTable{ arena };
+	unordered_map<string_view, int> symbolIndex;	// ime -> indeks u symbolTable
+	void addSymbol(string name, Section* section, int offset, bool isGlobal);
+	Symbol* findByName(string& name);
+
+	// Numericke lokalne labele (1:, 1f, 1b). Lekser k-tu definiciju broja N imenuje N.k, a referencu
+	// zamenjuje imenom definicije, pa prolazi ne razlikuju smer. Labele nisu u tabeli simbola;
+	// indeks im je indeks simbola sekcije, na koji ide relokacija iz druge sekcije.
+	struct ForwardReference {
+		string number;
+		int ordinal;
+		string text;	// kao u izvornom kodu, za poruku
+		int line;
+	};
+	unordered_map<string, int> localDefinitions;	// lekser: broj -> definicija do sada
+	vector<ForwardReference> forwardReferences;	// lekser: Nf, provera na kraju
+	ArenaVector<Symbol> localLabels{ arena };
+	unordered_map<string_view, int> localIndex;	// N.k -> indeks u localLabels
+	string defineLocalLabel(const string& number);
+	string localReference(const string& operand, int line);
+	void checkForwardReferences();
+
+	ArenaVector<Relocation> relocations{ arena };
+	void addRelocation(const Relocation& relocation);
+
+	LineTable lineTable;
+
+	unordered_map<string, MappedFile*> mappedFiles;	// .incbin fajlovi, svaki se mapira samo jednom
+	mutex mappedFilesMutex;	// -j: oba prolaza mapiraju iz vise niti
+	MappedFile* mapFile(const string& fileName);
+	void parseIncbin(const string& rest, MappedFile*& file, int& offset, int& length);
+
+	ArenaVector<string_view> errorList{ arena };
+	void error(string description, bool fatal);
+
+	int processInstruction(Entry* entry, Section* section, string instructionToken, string firstOperand = "", string secondOperand = "");
+	int operandToMask(Entry* entry, Section* section, string operand, int*& additionalBytes);
+	bool processSymbol(Entry* entry, Section* section, string symbol, RelType relType, int& value);
+	Section* findSection(string_view name);
+	bool addEntry(Section* section, const Entry& entry);
+	bool addBlob(Section* section, int offset, const char* data, int size);
+	bool isImmediate(string operand);
+	int evaluateExpression(string expression);
+
+	struct FormatJob {
+		int section;
+		vector<Relocation> relocations;	// samo relokacije te sekcije
+	};
+	SpscQueue<FormatJob>* formatQueue = nullptr;
+	string formattedSections[4];	// -P: listing sekcija, formatiran tokom drugog prolaza
+	void sectionDone(Section* section, bool withLiterals = false);
+
+	void printSection(ostream& ofs, const Section* s, Span<const Relocation> table) const;
+	void printRelocationTable(ostream& ofs, const Section* s, Span<const Relocation> table) const;
+	void printLineProgram(ostream& ofs) const;
+	
+};
@@ -0,0 +1,509 @@
+#include "blocklayout.h"
+#include "assembler.h"
+#include "peephole.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_set>
+#include <cctype>
+
+
+// Razdvaja npr. "jmpeq" na "jmp" i "eq" (nijedna mnemonika se ne zavrsava uslovom).
+static void splitMnemonic(const string& token, string& base, string& condition) {
+	base = token;
+	condition = "";
+	if (token.size() > 2 && Instruction::conditionCodes.count(token.substr(token.size() - 2))) {
+		base = token.substr(0, token.size() - 2);
+		condition = token.substr(token.size() - 2);
+	}
+}
+
+
+// Imena u operandu: simboli, i u izrazima i u r1[ime]. Broj kao 0x1F nije ime,
+// a lokalna labela N.k (posle razresavanja 1f/1b) jeste.
+static void namesIn(const string& operand, vector<string>& names) {
+	size_t i = 0;
+	while (i < operand.size()) {
+		if (i > 0 && isalnum((unsigned char) operand[i - 1])) {
+			i++;
+		}
+		else if (isalpha((unsigned char) operand[i]) || operand[i] == '_') {
+			size_t j = i + 1;
+			while (j < operand.size() && isalnum((unsigned char) operand[j])) {
+				j++;
+			}
+			names.push_back(operand.substr(i, j - i));
+			i = j;
+		}
+		else if (isdigit((unsigned char) operand[i])) {
+			size_t j = i + 1;
+			while (j < operand.size() && isdigit((unsigned char) operand[j])) {
+				j++;
+			}
+			size_t k = j + 1;
+			while (k < operand.size() && isdigit((unsigned char) operand[k])) {
+				k++;
+			}
+			if (j < operand.size() && operand[j] == '.' && k > j + 1) {
+				names.push_back(operand.substr(i, k - i));
+			}
+			i = k;
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+
+// Red profila: od do broj, gde je blok zadat labelom ili brojem linije prve naredbe; # je komentar.
+bool BlockLayout::loadProfile(const string& fileName, string& message) {
+	ifstream ifs(fileName);
+	if (!ifs.is_open()) {
+		message = "Cannot open profile file: " + fileName;
+		return false;
+	}
+	string line;
+	int number = 0;
+	while (getline(ifs, line)) {
+		number++;
+		size_t comment = line.find('#');
+		if (comment != string::npos) {
+			line.erase(comment);
+		}
+		istringstream fields(line);
+		string from, to;
+		long long count;
+		if (!(fields >> from)) {
+			continue;
+		}
+		string rest;
+		if (!(fields >> to >> count) || (fields >> rest) || count < 0) {
+			message = "Profile syntax error at line " + to_string(number) + ": " + fileName;
+			return false;
+		}
+		profile[{ from, to }] += count;
+	}
+	return true;
+}
+
+
+int BlockLayout::blockNamed(const string& name, const map<string, int>& byLabel) const {
+	auto it = byLabel.find(name);
+	if (it != byLabel.end()) {
+		return it->second;
+	}
+	if (!name.empty() && all_of(name.begin(), name.end(), [](char c) { return isdigit((unsigned char) c); })) {
+		int line = stoi(name);
+		for (size_t b = 0; b < blocks.size(); b++) {
+			if (blocks[b].firstLine == line) {
+				return (int) b;
+			}
+		}
+	}
+	return -1;
+}
+
+
+bool BlockLayout::build(const vector<Statement>& statements, size_t begin, size_t end, vector<Statement>& globals) {
+	bool closed = true;	// poslednji blok se zavrsio skokom ili povratkom
+	for (size_t i = begin; i < end; i++) {
+		const Statement& s = statements[i];
+		if (s.type == GLOBAL) {
+			globals.push_back(s);
+			continue;
+		}
+
+		if (s.type == LABEL) {
+			if (blocks.empty() || blocks.back().code > 0) {
+				blocks.emplace_back();
+				blocks.back().firstLine = s.line;
+				closed = false;
+			}
+			blocks.back().labels.push_back(s.token);
+			blocks.back().body.push_back(s);
+			continue;
+		}
+
+		if (blocks.empty() || closed) {
+			blocks.emplace_back();
+			blocks.back().firstLine = s.line;
+			closed = false;
+		}
+		Block& block = blocks.back();
+		block.body.push_back(s);
+		block.code++;
+
+		if (s.type == DIRECTIVE) {
+			if (s.token == ".align") {
+				skipped = ".align in .text at line " + to_string(s.line);
+				return false;
+			}
+			block.data = true;
+			continue;
+		}
+		if (s.type != INSTRUCTION) {
+			continue;
+		}
+
+		string base, condition;
+		splitMnemonic(s.token, base, condition);
+		bool conditional = !condition.empty() && condition != "al";
+
+		if ((conditional || base == "call") && !block.setsFlags) {	// pozvani kod moze da cita flegove
+			block.readsFlags = true;
+		}
+		if (base == "cmp" || base == "test") {
+			block.setsFlags = true;
+		}
+
+		if (base == "jmp") {
+			if (Assembler::parseToken(s.operands[0]) != SYMBOL) {
+				skipped = "indirect jump at line " + to_string(s.line);
+				return false;
+			}
+			block.exit = conditional ? COND_JUMP : JUMP;
+			block.condition = condition;
+			closed = true;
+		}
+		else if ((base == "ret" || base == "iret") && !conditional) {
+			block.exit = RETURN;
+			closed = true;
+		}
+	}
+
+	map<string, int> byLabel;
+	for (size_t b = 0; b < blocks.size(); b++) {
+		for (const string& label : blocks[b].labels) {
+			byLabel[label] = (int) b;
+		}
+	}
+	int n = (int) blocks.size();
+	for (int b = 0; b < n; b++) {
+		Block& block = blocks[b];
+		if (block.exit == JUMP || block.exit == COND_JUMP) {
+			const string& label = block.body.back().operands[0];
+			auto it = byLabel.find(label);
+			if (it == byLabel.end()) {
+				skipped = "jump to a label outside .text: " + label;
+				return false;
+			}
+			block.target = it->second;
+		}
+		if (block.exit != JUMP && block.exit != RETURN) {
+			block.fall = b + 1;	// n je kraj sekcije
+		}
+	}
+
+	for (auto& edge : profile) {
+		int from = blockNamed(edge.first.first, byLabel);
+		int to = blockNamed(edge.first.second, byLabel);
+		if (from >= 0 && to >= 0 && (blocks[from].target == to || blocks[from].fall == to)) {
+			profileEdges++;
+		}
+	}
+	return true;
+}
+
+
+// Koreni: prvi blok, blokovi sa podacima i labele koje se koriste van direktnog skoka
+// (.global, call, adresa, izraz). Ostalo se cuva samo ako je dostizno iz korena.
+void BlockLayout::markKept(const vector<Statement>& statements, size_t begin, size_t end) {
+	unordered_set<string> referenced;
+	for (size_t i = 0; i < statements.size(); i++) {
+		const Statement& s = statements[i];
+		if (s.type == LABEL) {
+			continue;
+		}
+		if (s.type == INSTRUCTION && i >= begin && i < end) {
+			string base, condition;
+			splitMnemonic(s.token, base, condition);
+			if (base == "jmp") {	// cilj je vec ivica grafa
+				continue;
+			}
+		}
+		vector<string> names;
+		for (const string& operand : s.operands) {
+			namesIn(operand, names);
+		}
+		referenced.insert(names.begin(), names.end());
+	}
+
+	int n = (int) blocks.size();
+	vector<int> stack;
+	for (int b = 0; b < n; b++) {
+		bool root = (b == 0) || blocks[b].data;
+		for (const string& label : blocks[b].labels) {
+			root = root || referenced.count(label);
+		}
+		if (root) {
+			blocks[b].kept = true;
+			stack.push_back(b);
+		}
+	}
+	while (!stack.empty()) {
+		int b = stack.back();
+		stack.pop_back();
+		for (int next : { blocks[b].target, blocks[b].fall }) {
+			if (next >= 0 && next < n && !blocks[next].kept) {
+				blocks[next].kept = true;
+				stack.push_back(next);
+			}
+		}
+	}
+}
+
+
+// Flegovi su zivi na ulazu ako ih blok cita pre cmp/test, ili ih ne postavlja a zivi su na izlazu.
+// Posle ret ih moze citati pozivalac, a kraj sekcije se ne izvrsava.
+void BlockLayout::computeFlags() {
+	int n = (int) blocks.size();
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int b = n - 1; b >= 0; b--) {
+			Block& block = blocks[b];
+			if (!block.kept || block.live) {
+				continue;
+			}
+			bool liveOut = (block.exit == RETURN);
+			for (int next : { block.target, block.fall }) {
+				if (next >= 0 && next < n && blocks[next].live) {
+					liveOut = true;
+				}
+			}
+			if (block.readsFlags || (!block.setsFlags && liveOut)) {
+				block.live = true;
+				changed = true;
+			}
+		}
+	}
+}
+
+
+// Lanci se spajaju po ivicama od najteze; ivica a->b spaja lanac koji se zavrsava sa a i lanac
+// koji pocinje sa b. Propadanje u blok sa zivim flegovima se spaja pre svega ostalog.
+// Lanac prvog bloka ide prvi, ostali redom kojim su im pocetni blokovi bili u originalu.
+vector<int> BlockLayout::order() {
+	int n = (int) blocks.size();
+
+	struct Edge {
+		int from;
+		int to;
+		long long weight;
+		bool forced;
+	};
+	vector<Edge> edges;
+
+	map<string, int> byLabel;
+	for (int b = 0; b < n; b++) {
+		for (const string& label : blocks[b].labels) {
+			byLabel[label] = b;
+		}
+	}
+	map<pair<int, int>, long long> counts;
+	for (auto& edge : profile) {
+		int from = blockNamed(edge.first.first, byLabel);
+		int to = blockNamed(edge.first.second, byLabel);
+		if (from >= 0 && to >= 0) {
+			counts[{ from, to }] += edge.second;
+		}
+	}
+
+	for (int b = 0; b < n; b++) {
+		const Block& block = blocks[b];
+		if (!block.kept) {
+			continue;
+		}
+		if (block.fall >= 0 && block.fall < n) {	// pre cilja skoka, pa pri istoj tezini ostaje propadanje
+			long long weight = profile.empty() ? ((block.exit == FALL) ? 3 : 1) : counts[{ b, block.fall }];
+			edges.push_back({ b, block.fall, weight, blocks[block.fall].live });
+		}
+		if (block.target >= 0) {	// uslovni skok unazad je verovatno petlja
+			long long weight = profile.empty() ? ((block.exit == JUMP || block.target <= b) ? 2 : 1) : counts[{ b, block.target }];
+			edges.push_back({ b, block.target, weight, false });
+		}
+	}
+	stable_sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+		if (a.forced != b.forced) {
+			return a.forced;
+		}
+		return a.weight > b.weight;
+	});
+
+	vector<vector<int>> chains(n);
+	vector<int> chainOf(n);
+	for (int b = 0; b < n; b++) {
+		chains[b].push_back(b);
+		chainOf[b] = b;
+	}
+	for (const Edge& e : edges) {
+		int from = chainOf[e.from];
+		int to = chainOf[e.to];
+		if (e.to == 0 || from == to || chains[from].back() != e.from || chains[to].front() != e.to) {
+			continue;
+		}
+		for (int b : chains[to]) {
+			chains[from].push_back(b);
+			chainOf[b] = from;
+		}
+		chains[to].clear();
+	}
+
+	vector<int> result;
+	for (int c = 0; c < n; c++) {	// lanac sa indeksom c pocinje blokom c, ako nije spojen
+		if (chains[c].empty() || !blocks[c].kept) {
+			continue;
+		}
+		result.insert(result.end(), chains[c].begin(), chains[c].end());
+	}
+	return result;
+}
+
+
+void BlockLayout::run(vector<Statement>& statements) {
+	size_t begin = 0;
+	while (begin < statements.size() && !(statements[begin].type == SECTION && statements[begin].token == ".text")) {
+		begin++;
+	}
+	if (begin == statements.size()) {
+		skipped = "no .text section";
+		return;
+	}
+	begin++;
+	size_t end = begin;
+	while (end < statements.size() && statements[end].type != SECTION && statements[end].type != END) {
+		end++;
+	}
+	for (size_t i = end; i < statements.size() && statements[i].type != END; i++) {
+		if (statements[i].type == SECTION && statements[i].token == ".text") {
+			skipped = ".text is reopened";
+			return;
+		}
+	}
+
+	vector<Statement> globals;
+	if (!build(statements, begin, end, globals) || blocks.empty()) {
+		return;
+	}
+	markKept(statements, begin, end);
+	computeFlags();
+	vector<int> placed = order();
+
+	int n = (int) blocks.size();
+	vector<int> position(n + 1, -1);
+	for (size_t k = 0; k < placed.size(); k++) {
+		position[placed[k]] = (int) k;
+	}
+
+	// labele za nove skokove; kraj sekcije (n) dobija labelu na kraju
+	unordered_set<string> names;
+	for (const Statement& s : statements) {
+		if (s.type == LABEL) {
+			names.insert(s.token);
+		}
+	}
+	int counter = 0;
+	vector<string> newLabels(n + 1);
+	auto labelOf = [&](int b) -> string {
+		if (b < n && !blocks[b].labels.empty()) {
+			return blocks[b].labels[0];
+		}
+		if (newLabels[b].empty()) {
+			do {
+				newLabels[b] = "_cfg" + to_string(++counter);
+			} while (names.count(newLabels[b]));
+		}
+		return newLabels[b];
+	};
+
+	vector<vector<Statement>> tails(n);	// skok koji se dodaje na kraj bloka
+	for (size_t k = 0; k < placed.size(); k++) {
+		int b = placed[k];
+		Block& block = blocks[b];
+		int next = (k + 1 < placed.size()) ? placed[k + 1] : n;
+		Statement& last = block.body.back();
+
+		if (block.exit == JUMP) {
+			if (block.target == next && !blocks[block.target].live) {
+				block.body.pop_back();
+				jumpsRemoved++;
+				bytesSaved += 4;
+			}
+			continue;
+		}
+		if (block.exit == RETURN || block.fall == next) {
+			continue;
+		}
+
+		if (block.exit == COND_JUMP && block.target == next && (block.condition == "eq" || block.condition == "ne")
+			&& !blocks[block.target].live && !blocks[block.fall].live) {
+			last.token = (block.condition == "eq") ? "jmpne" : "jmpeq";
+			last.operands[0] = labelOf(block.fall);
+			branchesInverted++;
+			continue;
+		}
+
+		Statement jump;
+		jump.line = last.line;
+		jump.type = INSTRUCTION;
+		jump.token = "jmp";
+		jump.operands.push_back(labelOf(block.fall));
+		tails[b].push_back(jump);
+		jumpsAdded++;
+		bytesSaved -= 4;
+	}
+
+	for (int b = 0; b < n; b++) {
+		if (!blocks[b].kept) {
+			removedBlocks++;
+			for (const Statement& s : blocks[b].body) {
+				if (s.type == INSTRUCTION) {
+					bytesSaved += Peephole::instructionSize(s);
+				}
+			}
+		}
+	}
+
+	vector<Statement> out(statements.begin(), statements.begin() + begin);
+	out.insert(out.end(), globals.begin(), globals.end());
+	for (int b : placed) {
+		if (!newLabels[b].empty()) {
+			Statement label;
+			label.line = blocks[b].firstLine;
+			label.type = LABEL;
+			label.token = newLabels[b];
+			out.push_back(label);
+		}
+		out.insert(out.end(), blocks[b].body.begin(), blocks[b].body.end());
+		out.insert(out.end(), tails[b].begin(), tails[b].end());
+	}
+	if (!newLabels[n].empty()) {
+		Statement label;
+		label.line = blocks.back().body.back().line;
+		label.type = LABEL;
+		label.token = newLabels[n];
+		out.push_back(label);
+	}
+	out.insert(out.end(), statements.begin() + end, statements.end());
+	statements.swap(out);
+}
+
+
+void BlockLayout::report(ostream& os) const {
+	os << "BLOCK LAYOUT" << endl << endl;
+	if (!skipped.empty()) {
+		os << "skipped: " << skipped << endl << endl;
+		return;
+	}
+	os << "blocks" << '\t' << '\t' << '\t' << blocks.size() << endl;
+	os << "unreachable removed" << '\t' << removedBlocks << endl;
+	os << "jumps removed" << '\t' << '\t' << jumpsRemoved << endl;
+	os << "jumps added" << '\t' << '\t' << jumpsAdded << endl;
+	os << "branches inverted" << '\t' << branchesInverted << endl;
+	if (!profile.empty()) {
+		os << "profile edges" << '\t' << '\t' << profileEdges << " of " << profile.size() << endl;
+	}
+	os << "bytes saved" << '\t' << '\t' << bytesSaved << endl << endl;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+#include "statement.h"
+
+
+using namespace std;
+
+
+
+// --layout: osnovni blokovi sekcije .text se preuredjuju tako da cesto izvrseni skokovi postanu
+// propadanje u sledeci blok, a nedostizni blokovi se brisu. Radi nad naredbama pre prvog prolaza,
+// pa se pomeraji, PC relativni skokovi i relokacije racunaju vec nad novim rasporedom.
+//
+// Blok pocinje labelom ili posle jmp, ret i iret. Ivice su cilj skoka (jmp labela) i propadanje.
+// Tezine ivica su iz profila (--profile) ili procena: propadanje 3, bezuslovni skok i uslovni
+// skok unazad 2, ostalo 1.
+// Lanci blokova se spajaju pohlepno po tezini ivica (Pettis-Hansen); prvi blok ostaje prvi.
+//
+// Flegovi: umetnuti jmp je add r7 i menja flegove, pa blok koji cita flegove pre cmp/test
+// (ili ih vraca sa ret) ostaje odmah iza bloka koji u njega propada.
+// Prolaz se preskace ako u .text postoji skok na adresu koja nije labela ili .align, ili ako se
+// .text otvara vise puta.
+class BlockLayout {
+private:
+	enum Exit { FALL, JUMP, COND_JUMP, RETURN };
+
+	struct Block {
+		vector<Statement> body;
+		vector<string> labels;
+		int firstLine = 0;
+		int code = 0;	// broj instrukcija i direktiva
+		bool data = false;	// ima direktivu: ne brise se ni kada nije dostizan
+		Exit exit = FALL;
+		string condition;	// uslov poslednjeg skoka
+		int target = -1;	// blok cilja skoka
+		int fall = -1;	// sledeci blok u originalu, blocks.size() za kraj sekcije
+		bool readsFlags = false;	// cita flegove pre nego sto ih postavi
+		bool setsFlags = false;
+		bool live = false;	// flegovi na ulazu se citaju
+		bool kept = false;
+	};
+	vector<Block> blocks;
+
+	map<pair<string, string>, long long> profile;	// (od, do) -> broj prolaza; blok je labela ili broj linije
+
+	string skipped;	// razlog ako prolaz nije primenjen
+	int removedBlocks = 0;
+	int jumpsRemoved = 0;
+	int jumpsAdded = 0;
+	int branchesInverted = 0;
+	int bytesSaved = 0;
+	int profileEdges = 0;	// ivice profila nadjene u grafu
+
+	bool build(const vector<Statement>& statements, size_t begin, size_t end, vector<Statement>& globals);
+	void markKept(const vector<Statement>& statements, size_t begin, size_t end);
+	void computeFlags();
+	vector<int> order();
+	int blockNamed(const string& name, const map<string, int>& byLabel) const;
+
+public:
+	bool loadProfile(const string& fileName, string& message);
+
+	void run(vector<Statement>& statements);
+	void report(ostream& os) const;
+
+};
@@ -0,0 +1,649 @@
+#include "disassembler.h"
+
+#include <algorithm>
+#include <sstream>
+#include <climits>
+#include <cstring>
+
+
+namespace {
+
+const char* operationNames[16] = { "add", "sub", "mul", "div", "cmp", "and", "or", "not",
+	"test", "push", "pop", "call", "iret", "mov", "shl", "shr" };
+const char* conditionSuffixes[4] = { "eq", "ne", "gt", "" };	// al se ne pise, to je podrazumevani uslov
+
+
+struct DecodeTables {
+	vector<DecodedWord> words;
+	string mnemonics[64];
+
+	DecodeTables();
+};
+
+
+bool validOperand(int mask) {
+	int mode = mask >> 3;
+	int reg = mask & 7;
+	switch (mode) {
+	case 0: return reg == 0 || reg == 7;	// neposredno ili psw
+	case 1: return true;	// registarsko direktno
+	case 2: return reg == 0;	// memorijsko direktno
+	case 3: return true;	// registarsko indirektno sa pomerajem, r7 je PC relativno
+	default: return false;
+	}
+}
+
+
+bool hasExtraWord(int mask) {
+	int mode = mask >> 3;
+	return (mode == 0 && (mask & 7) == 0) || mode == 2 || mode == 3;
+}
+
+
+// Sve kombinacije se proveravaju jednom; posle je dekodovanje jedno citanje iz tabele.
+DecodeTables::DecodeTables() : words(65536) {
+	for (int i = 0; i < 64; i++) {
+		mnemonics[i] = string(operationNames[i & 15]) + conditionSuffixes[i >> 4];
+	}
+
+	for (int w = 0; w < 65536; w++) {
+		int cond = w >> 14;
+		int op = (w >> 10) & 15;
+		int dst = (w >> 5) & 31;
+		int src = w & 31;
+
+		DecodedWord& d = words[w];
+		d.mnemonic = (uint8_t) (cond * 16 + op);
+
+		switch (op) {
+		case PUSH: case CALL: {
+			d.valid = dst == 0 && validOperand(src);
+			d.operands = 1;
+			d.first = (uint8_t) src;
+			break;
+		}
+		case POP: {
+			d.valid = src == 0 && validOperand(dst) && dst != 7;	// odrediste ne sme biti psw
+			d.immediateDestination = dst == 0;
+			d.operands = 1;
+			d.first = (uint8_t) dst;
+			break;
+		}
+		case IRET: {
+			d.valid = dst == 0 && src == 0;
+			d.operands = 0;
+			break;
+		}
+		default: {
+			d.valid = validOperand(dst) && dst != 7 && validOperand(src);
+			d.immediateDestination = dst == 0;
+			d.operands = 2;
+			d.first = (uint8_t) dst;
+			d.second = (uint8_t) src;
+			break;
+		}
+		}
+
+		bool firstExtra = d.operands >= 1 && hasExtraWord(d.first);
+		bool secondExtra = d.operands == 2 && hasExtraWord(d.second);
+		if (firstExtra && secondExtra) {	// asembler odbija dva operanda sa dodatnom reci
+			d.valid = false;
+		}
+		d.size = (firstExtra || secondExtra) ? 4 : 2;
+	}
+}
+
+
+const DecodeTables& tables() {
+	static const DecodeTables t;
+	return t;
+}
+
+
+// Ispis ide u bafer jedne stavke koji je dovoljan za najduzu liniju,
+// bez provere kapaciteta po znaku.
+void appendDec(char*& p, unsigned value) {
+	char buffer[16];
+	int n = 0;
+	do {
+		buffer[n++] = (char) ('0' + value % 10);
+		value /= 10;
+	} while (value);
+	while (n) {
+		*p++ = buffer[--n];
+	}
+}
+
+
+void appendHex(char*& p, unsigned value, int digits) {
+	static const char hexDigits[] = "0123456789ABCDEF";
+	for (int i = digits - 1; i >= 0; i--) {
+		*p++ = hexDigits[(value >> (i * 4)) & 15];
+	}
+}
+
+
+void appendText(char*& p, const char* text, size_t length) {
+	memcpy(p, text, length);
+	p += length;
+}
+
+
+void appendText(char*& p, string_view text) {
+	appendText(p, text.data(), text.size());
+}
+
+
+void appendText(char*& p, const char* text) {
+	appendText(p, text, strlen(text));
+}
+
+
+void flatten(const Section& section, vector<unsigned char>& bytes) {
+	vector<char> buffer;
+	vector<ImagePart> parts;
+	section.image(buffer, parts);
+	bytes.clear();
+	for (const ImagePart& part : parts) {
+		bytes.insert(bytes.end(), part.data, part.data + part.size);
+	}
+}
+
+}
+
+
+
+SymbolIndex::SymbolIndex(Span<const Section> sections, Span<const Symbol> symbols) {
+	for (const Section& section : sections) {
+		if (section.startAddress < 0) {
+			continue;
+		}
+		vector<const Symbol*> own;
+		const Symbol* sectionSymbol = nullptr;
+		for (const Symbol& symbol : symbols) {
+			if (symbol.section != section.name) {
+				continue;
+			}
+			if (symbol.name[0] == '.') {	// simbol sekcije (.text, ...)
+				sectionSymbol = &symbol;
+			}
+			else {
+				own.push_back(&symbol);
+			}
+		}
+		stable_sort(own.begin(), own.end(), [](const Symbol* a, const Symbol* b) { return a->offset < b->offset; });
+
+		int end = section.startAddress + section.size();
+		size_t first = intervals.size();
+		if (sectionSymbol && (own.empty() || own[0]->offset > 0)) {
+			intervals.push_back({ section.startAddress, end, sectionSymbol });
+		}
+		for (const Symbol* symbol : own) {
+			int start = section.startAddress + symbol->offset;
+			if (intervals.size() > first && intervals.back().start == start) {
+				continue;	// vise labela na istoj adresi: prva se koristi
+			}
+			if (intervals.size() > first) {
+				intervals.back().end = start;
+			}
+			intervals.push_back({ start, end, symbol });
+		}
+	}
+	sort(intervals.begin(), intervals.end(), [](const SymbolInterval& a, const SymbolInterval& b) { return a.start < b.start; });
+}
+
+
+const SymbolInterval* SymbolIndex::lookup(int address) const {
+	auto it = upper_bound(intervals.begin(), intervals.end(), address,
+		[](int a, const SymbolInterval& interval) { return a < interval.start; });
+	if (it == intervals.begin()) {
+		return nullptr;
+	}
+	--it;
+	if (address >= it->end) {
+		return nullptr;
+	}
+	return &*it;
+}
+
+
+
+Disassembler::Disassembler(const Result& r) : result(r), index(r.sections, r.symbols) {
+	for (const Section& section : result.sections) {
+		if (section.name == "RODATA") {
+			rodata = &section;
+		}
+	}
+	if (result.literalPool >= 0) {
+		flatten(*rodata, rodataImage);
+	}
+	for (const Symbol& symbol : result.symbols) {
+		longestName = max(longestName, symbol.name.size());
+	}
+}
+
+
+const DecodedWord* Disassembler::table() {
+	return tables().words.data();
+}
+
+
+void Disassembler::disassemble(string& out, Format format) const {
+	vector<const Section*> order;
+	for (const Section& section : result.sections) {
+		if (section.startAddress >= 0) {
+			order.push_back(&section);
+		}
+	}
+	stable_sort(order.begin(), order.end(), [](const Section* a, const Section* b) { return a->startAddress < b->startAddress; });
+
+	if (format == SOURCE) {	// .global se obradjuje u drugom prolazu, pa moze pre sekcija
+		bool first = true;
+		for (const Symbol& symbol : result.symbols) {
+			if (symbol.isGlobal && symbol.section != "?" && symbol.name[0] != '.') {
+				out += first ? ".global " : ", ";
+				out += symbol.name;
+				first = false;
+			}
+		}
+		if (!first) {
+			out += '\n';
+		}
+	}
+
+	for (const Section* section : order) {
+		disassembleSection(out, format, *section);
+	}
+
+	if (format == SOURCE) {
+		out += ".end\n";
+	}
+}
+
+
+vector<const Symbol*> Disassembler::labelsOf(const Section& section) const {
+	vector<const Symbol*> labels;
+	for (const Symbol& symbol : result.symbols) {
+		if (symbol.section == section.name && symbol.name[0] != '.') {
+			labels.push_back(&symbol);
+		}
+	}
+	stable_sort(labels.begin(), labels.end(), [](const Symbol* a, const Symbol* b) { return a->offset < b->offset; });
+	return labels;
+}
+
+
+vector<const Relocation*> Disassembler::relocationsOf(const Section& section) const {
+	vector<const Relocation*> relocations;
+	for (const Relocation& relocation : result.relocations) {
+		if (relocation.section == section.name) {
+			relocations.push_back(&relocation);
+		}
+	}
+	stable_sort(relocations.begin(), relocations.end(), [](const Relocation* a, const Relocation* b) { return a->offset < b->offset; });
+	return relocations;
+}
+
+
+// Listing: adresa, bajtovi, tekst, simbolicki cilj. Izvor: labele i tekst, bez adresa.
+void Disassembler::disassembleSection(string& out, Format format, const Section& section) const {
+	int size = section.size();
+	if (format == SOURCE && &section == rodata && result.literalPool >= 0) {
+		size = result.literalPool;	// bazen literala pravi ponovno prevodjenje iz =konstanti
+	}
+	vector<char> line(128 + 2 * longestName);	// jedna stavka se slaze ovde, pa dodaje na izlaz
+	char* p = line.data();
+
+	if (format == LISTING) {
+		appendText(p, section.name);
+		appendText(p, "\tstart ");
+		appendHex(p, section.startAddress, 8);
+		appendText(p, "\tsize ");
+		appendDec(p, size);
+	}
+	else {
+		*p++ = '.';
+		for (char c : section.name) {
+			*p++ = (char) tolower(c);
+		}
+	}
+	*p++ = '\n';
+
+	vector<unsigned char> bytes;
+	if (!section.nobits) {
+		flatten(section, bytes);
+	}
+	vector<const Symbol*> labels = labelsOf(section);
+	vector<const Relocation*> relocations = relocationsOf(section);
+	bool code = (section.name == "TEXT");	// instrukcije su dozvoljene samo u .text
+
+	const DecodedWord* words = table();
+	const string* mnemonics = tables().mnemonics;
+
+	size_t label = 0;
+	size_t relocation = 0;
+	int offset = 0;
+	while (offset < size || label < labels.size()) {
+		out.append(line.data(), p - line.data());
+		p = line.data();
+
+		if (label < labels.size() && labels[label]->offset <= offset) {
+			if (format == LISTING) {
+				appendHex(p, section.startAddress + labels[label]->offset, 8);
+				appendText(p, " <", 2);
+				appendText(p, labels[label]->name);
+				appendText(p, ">:\n", 3);
+			}
+			else {
+				appendText(p, labels[label]->name);
+				appendText(p, ":\n", 2);
+			}
+			label++;
+			continue;
+		}
+		if (offset >= size) {
+			break;
+		}
+		int nextLabel = (label < labels.size()) ? labels[label]->offset : INT_MAX;
+		int limit = min(size, nextLabel);	// stavka ne sme da prekrije labelu
+		int address = section.startAddress + offset;
+
+		if (section.nobits) {
+			if (format == LISTING) {
+				appendHex(p, address, 8);
+				*p++ = '\t';
+			}
+			appendText(p, "\t.skip ", 7);
+			appendDec(p, limit - offset);
+			*p++ = '\n';
+			offset = limit;
+			continue;
+		}
+
+		const DecodedWord* d = nullptr;
+		if (code && limit - offset >= 2) {
+			d = &words[bytes[offset] | (bytes[offset + 1] << 8)];	// slika je little-endian
+			if (!d->valid || offset + d->size > limit) {
+				d = nullptr;
+			}
+		}
+
+		const Relocation* r = nullptr;
+		if (d) {
+			while (relocation < relocations.size() && relocations[relocation]->offset < offset) {
+				relocation++;
+			}
+			if (relocation < relocations.size() && relocations[relocation]->offset == offset) {
+				r = relocations[relocation];
+			}
+			if (format == SOURCE && d->immediateDestination && !r) {	// neposredno odrediste bez simbola se ne moze napisati
+				d = nullptr;
+			}
+		}
+
+		if (d) {
+			int extra = (d->size == 4) ? (bytes[offset + 2] | (bytes[offset + 3] << 8)) : 0;
+
+			if (format == LISTING) {
+				appendHex(p, address, 8);
+				*p++ = '\t';
+				for (int i = 0; i < d->size; i++) {
+					appendHex(p, bytes[offset + i], 2);
+					*p++ = ' ';
+				}
+				if (d->size == 2) {
+					appendText(p, "      ", 6);
+				}
+			}
+			*p++ = '\t';
+			appendText(p, mnemonics[d->mnemonic]);
+
+			// dodatna rec (i relokacija) pripada najvise jednom operandu
+			if (d->operands >= 1) {
+				*p++ = ' ';
+				appendOperand(p, d->first, extra, r);
+			}
+			if (d->operands == 2) {
+				*p++ = ',';
+				*p++ = ' ';
+				appendOperand(p, d->second, extra, r);
+			}
+
+			if (format == LISTING && !r) {	// cilj skoka ili memorijskog operanda, ako pada u neku sekciju
+				int op = d->mnemonic & 15;
+				int target = -1;
+				unsigned value;
+				if ((d->operands >= 1 && (d->first >> 3) == 2) || (d->operands == 2 && (d->second >> 3) == 2)) {
+					target = literal(extra, nullptr, value) ? -1 : extra;
+				}
+				else if ((d->operands >= 1 && d->first == (3 << 3 | 7)) || (d->operands == 2 && d->second == (3 << 3 | 7))) {
+					target = address + d->size + (int16_t) extra;	// PC relativno
+				}
+				else if (d->operands == 2 && d->first == (1 << 3 | 7) && d->second == 0) {	// skok: add r7, pomeraj ili mov r7, adresa
+					if (op == ADD) {
+						target = address + d->size + (int16_t) extra;
+					}
+					else if (op == MOV) {
+						target = extra;
+					}
+				}
+				if (target >= 0) {
+					appendTarget(p, target);
+				}
+			}
+			*p++ = '\n';
+			offset += d->size;
+			continue;
+		}
+
+		// podaci (ili rec koja nije ispravna instrukcija)
+		int row = min(limit - offset, code ? 2 : 8);
+		if (format == LISTING) {
+			appendHex(p, address, 8);
+			*p++ = '\t';
+			for (int i = 0; i < row; i++) {
+				appendHex(p, bytes[offset + i], 2);
+				*p++ = ' ';
+			}
+		}
+		appendText(p, "\t.char ", 7);
+		for (int i = 0; i < row; i++) {
+			if (i) {
+				*p++ = ',';
+				*p++ = ' ';
+			}
+			appendDec(p, bytes[offset + i]);
+		}
+		*p++ = '\n';
+		offset += row;
+	}
+
+	*p++ = '\n';
+	out.append(line.data(), p - line.data());
+}
+
+
+// Simbol relokacije se pise samo ako odgovara nacinu adresiranja i tipu relokacije.
+void Disassembler::appendOperand(char*& p, int mask, int extra, const Relocation* relocation) const {
+	int mode = mask >> 3;
+	int reg = mask & 7;
+	const string_view* symbol = (relocation && hasExtraWord(mask)) ? &result.symbols[relocation->index].name : nullptr;
+
+	switch (mode) {
+	case 0: {
+		if (reg == 7) {
+			appendText(p, "psw", 3);
+		}
+		else if (symbol && relocation->relType == R_386_32) {
+			*p++ = '&';
+			appendText(p, *symbol);
+		}
+		else {
+			appendDec(p, extra);
+		}
+		break;
+	}
+	case 1: {
+		*p++ = 'r';
+		*p++ = (char) ('0' + reg);
+		break;
+	}
+	case 2: {
+		unsigned value;
+		if (literal(extra, relocation, value)) {
+			appendText(p, "=0x", 3);
+			appendHex(p, value, 8);
+		}
+		else if (symbol && relocation->relType == R_386_32) {
+			*p++ = '#';
+			appendText(p, *symbol);
+		}
+		else {
+			*p++ = '*';
+			appendDec(p, extra);
+		}
+		break;
+	}
+	default: {
+		if (reg == 7 && symbol && relocation->relType == R_386_PC32) {
+			*p++ = '$';
+			appendText(p, *symbol);
+			break;
+		}
+		*p++ = 'r';
+		*p++ = (char) ('0' + reg);
+		*p++ = '[';
+		if (reg != 7 && symbol && relocation->relType == R_386_32) {
+			appendText(p, *symbol);
+		}
+		else {
+			appendDec(p, extra);
+		}
+		*p++ = ']';
+		break;
+	}
+	}
+}
+
+
+// Memorijski operand koji pokazuje u bazen literala: uz relokaciju na .rodata rec je
+// pomeraj u sekciji, bez nje (--absolute) apsolutna adresa.
+bool Disassembler::literal(int extra, const Relocation* relocation, unsigned& value) const {
+	if (result.literalPool < 0) {
+		return false;
+	}
+	int offset;
+	if (relocation) {
+		if (relocation->relType != R_386_32 || result.symbols[relocation->index].name != ".rodata") {
+			return false;
+		}
+		offset = extra;
+	}
+	else {
+		offset = extra - rodata->startAddress;
+	}
+	if (offset < result.literalPool || offset + 4 > (int) rodataImage.size() || (offset - result.literalPool) % 4 != 0) {
+		return false;
+	}
+	const unsigned char* b = &rodataImage[offset];
+	value = b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned) b[3] << 24);
+	return true;
+}
+
+
+void Disassembler::appendTarget(char*& p, int address) const {
+	const SymbolInterval* interval = index.lookup(address);
+	if (!interval) {
+		return;
+	}
+	appendText(p, "\t<", 2);
+	appendText(p, interval->symbol->name);
+	int delta = address - interval->start;
+	if (delta != 0) {
+		appendText(p, "+0x", 3);
+		int digits = 1;
+		while (digits < 8 && (delta >> (digits * 4)) != 0) {
+			digits++;
+		}
+		appendHex(p, delta, digits);
+	}
+	*p++ = '>';
+}
+
+
+bool Disassembler::roundTrip(const Result& original, const Options& originalOptions, ostream& report) {
+	string source;
+	Disassembler(original).disassemble(source, SOURCE);
+
+	Options options;	// bez -O, --layout i -D: izvorni oblik je vec razresen
+	options.startAddress = originalOptions.startAddress;
+	options.absolute = originalOptions.absolute;	// =konstanta se prevodi isto kao u originalu
+	options.pageSize = originalOptions.pageSize;
+
+	Result again = assemble(source, options);
+	if (!again.success) {
+		report << "Disassembly does not assemble:" << endl;
+		for (const string& error : again.errors) {
+			report << error << endl;
+		}
+		return false;
+	}
+
+	bool same = true;
+	size_t total = 0;
+	for (size_t i = 0; i < original.sections.size(); i++) {
+		const Section& a = original.sections[i];
+		const Section& b = again.sections[i];
+		if (a.startAddress != b.startAddress || a.size() != b.size()) {
+			report << a.name << ": address/size " << a.startAddress << "/" << a.size() << " became " << b.startAddress << "/" << b.size() << endl;
+			same = false;
+			continue;
+		}
+		vector<unsigned char> x, y;
+		flatten(a, x);
+		flatten(b, y);
+		total += a.size();
+		if (x != y) {
+			size_t at = mismatch(x.begin(), x.end(), y.begin(), y.end()).first - x.begin();
+			report << a.name << ": bytes differ at offset " << at << endl;
+			same = false;
+		}
+	}
+
+	for (const Symbol& s : original.symbols) {
+		const Symbol* t = nullptr;
+		for (const Symbol& candidate : again.symbols) {
+			if (candidate.name == s.name) {
+				t = &candidate;
+				break;
+			}
+		}
+		if (!t || t->section != s.section || (s.section != "?" && t->offset != s.offset) || t->isGlobal != s.isGlobal) {
+			report << "symbol " << s.name << " differs" << endl;
+			same = false;
+		}
+	}
+
+	vector<string> x, y;
+	for (const Relocation& r : original.relocations) {
+		ostringstream key;
+		key << r.section << ' ' << r.offset << ' ' << r.relType << ' ' << original.symbols[r.index].name;
+		x.push_back(key.str());
+	}
+	for (const Relocation& r : again.relocations) {
+		ostringstream key;
+		key << r.section << ' ' << r.offset << ' ' << r.relType << ' ' << again.symbols[r.index].name;
+		y.push_back(key.str());
+	}
+	sort(x.begin(), x.end());
+	sort(y.begin(), y.end());
+	if (x != y) {
+		report << "relocations differ (" << x.size() << " / " << y.size() << ")" << endl;
+		same = false;
+	}
+
+	if (same) {
+		report << "round trip OK: " << total << " bytes, " << original.symbols.size() << " symbols, " << x.size() << " relocations" << endl;
+	}
+	return same;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+
+#include "assembler.h"
+
+
+using namespace std;
+
+
+
+// Dekodovana prva rec instrukcije (uslov 2 | kod operacije 4 | dst 5 | src 5 bita).
+// Maska operanda je nacin adresiranja << 3 | registar, kao u operandToMask.
+struct DecodedWord {
+	uint8_t valid;
+	uint8_t size;	// 2, ili 4 ako neki operand ima dodatnu rec
+	uint8_t mnemonic;	// uslov * 16 + kod operacije, indeks u tabelu mnemonika
+	uint8_t operands;	// 0, 1 ili 2
+	uint8_t first;	// maska operanda koji se ispisuje prvi
+	uint8_t second;
+	uint8_t immediateDestination;	// &simbol kao odrediste: u izvornom obliku moze samo uz relokaciju
+};
+
+
+struct SymbolInterval {
+	int start;	// apsolutne adrese, [start, end)
+	int end;
+	const Symbol* symbol;
+};
+
+
+// Indeks simbola po adresi: svaki simbol pokriva opseg do sledeceg simbola
+// ili do kraja svoje sekcije. Labele imaju prednost nad simbolom sekcije.
+class SymbolIndex {
+private:
+	vector<SymbolInterval> intervals;
+
+public:
+	SymbolIndex(Span<const Section> sections, Span<const Symbol> symbols);
+
+	const SymbolInterval* lookup(int address) const;	// nullptr ako adresa nije ni u jednoj sekciji
+
+	const vector<SymbolInterval>& all() const { return intervals; }
+};
+
+
+// Disasembler nad rezultatom prevodjenja. Listing je za citanje (adresa, bajtovi,
+// instrukcija, simbolicki cilj); izvorni oblik se moze ponovo prevesti u iste bajtove.
+class Disassembler {
+public:
+	enum Format { LISTING, SOURCE };
+
+	Disassembler(const Result& r);
+
+	void disassemble(string& out, Format format) const;
+
+	static const DecodedWord* table();	// 65536 stavki, indeks je prva rec
+
+	// Prevodi izvorni oblik i poredi sekcije, simbole i relokacije sa originalom.
+	static bool roundTrip(const Result& original, const Options& originalOptions, ostream& report);
+
+private:
+	const Result& result;
+	SymbolIndex index;
+
+	void disassembleSection(string& out, Format format, const Section& section) const;
+
+	size_t longestName = 0;	// za procenu najduze linije ispisa
+
+	const Section* rodata = nullptr;
+	vector<unsigned char> rodataImage;	// za citanje vrednosti iz bazena literala
+	bool literal(int extra, const Relocation* relocation, unsigned& value) const;
+
+	void appendOperand(char*& p, int mask, int extra, const Relocation* relocation) const;
+	void appendTarget(char*& p, int address) const;
+
+	vector<const Symbol*> labelsOf(const Section& section) const;
+	vector<const Relocation*> relocationsOf(const Section& section) const;
+
+};
@@ -0,0 +1,111 @@
+#include "encodingcache.h"
+
+#include <iomanip>
+
+
+string EncodingCache::key(const Statement& statement) {
+	string key = statement.token;
+	for (const string& operand : statement.operands) {
+		key += ' ';
+		key += operand;
+	}
+	return key;
+}
+
+
+// Operandi su vec provereni u prvom prolazu, pa je dovoljan prvi znak:
+// broj, -broj, 0x, *adresa, psw, rN i rN[broj].
+static bool constantOperand(const string& operand) {
+	if (operand.find('.') != string::npos) {	// lokalna labela (1.0), i u rX[1.0]
+		return false;
+	}
+	char c = operand[0];
+	if ((c >= '0' && c <= '9') || c == '-' || c == '*' || operand == "psw") {
+		return true;
+	}
+	if (c == 'r' && operand.size() >= 2 && operand[1] >= '0' && operand[1] <= '7') {
+		return operand.size() == 2 || (operand[2] == '[' && operand.size() > 3 && operand[3] >= '0' && operand[3] <= '9');
+	}
+	return false;
+}
+
+
+bool EncodingCache::cacheable(const Statement& statement) {
+	for (const string& operand : statement.operands) {
+		if (!constantOperand(operand)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool EncodingCache::findSize(const string& key, int& size) {
+	sizeLookups++;
+	auto it = sizes.find(key);
+	if (it == sizes.end()) {
+		return false;
+	}
+	sizeHits++;
+	size = it->second;
+	return true;
+}
+
+
+void EncodingCache::addSize(const string& key, int size) {
+	if (sizes.size() < MAX_ENTRIES) {
+		sizes[key] = size;
+	}
+}
+
+
+bool EncodingCache::findEncoding(const string& key, int& value, int& size) {
+	encodeLookups++;
+	auto it = encodings.find(key);
+	if (it == encodings.end()) {
+		return false;
+	}
+	encodeHits++;
+	value = it->second.value;
+	size = it->second.size;
+	return true;
+}
+
+
+void EncodingCache::addEncoding(const string& key, int value, int size) {
+	if (encodings.size() < MAX_ENTRIES) {
+		encodings[key] = { value, size };
+	}
+}
+
+
+void EncodingCache::addStats(const EncodingCache& other) {
+	sizeLookups += other.sizeLookups;
+	sizeHits += other.sizeHits;
+	encodeLookups += other.encodeLookups;
+	encodeHits += other.encodeHits;
+	notCacheable += other.notCacheable;
+}
+
+
+static void reportRow(ostream& os, const char* pass, long long lookups, long long hits) {
+	os << pass << '\t' << '\t' << lookups << '\t' << hits << '\t';
+	if (lookups > 0) {
+		os << fixed << setprecision(1) << 100.0 * hits / lookups << '%';
+		os.unsetf(ios::floatfield);
+	}
+	else {
+		os << '-';
+	}
+	os << endl;
+}
+
+
+void EncodingCache::report(ostream& os) const {
+	os << "ENCODING CACHE" << endl << endl;
+	os << "pass" << '\t' << '\t' << "lookups" << '\t' << "hits" << '\t' << "hit rate" << endl;
+	os << "----" << '\t' << '\t' << "-------" << '\t' << "----" << '\t' << "--------" << endl;
+	reportRow(os, "first", sizeLookups, sizeHits);
+	reportRow(os, "second", encodeLookups, encodeHits);
+	os << "not cacheable" << '\t' << notCacheable << endl << endl;
+}
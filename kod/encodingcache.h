@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <iostream>
+
+#include "statement.h"
+
+
+using namespace std;
+
+
+
+// Kodiranje instrukcije po tekstu naredbe (mnemonika i operandi), da se isti red ne bi ponovo
+// prepoznavao regularnim izrazima i kodirao. Prvi prolaz pamti velicinu, koja uvek zavisi samo
+// od teksta. Drugi prolaz pamti kod samo za operande bez simbola i literala (registri,
+// neposredne vrednosti, psw, *adresa, rN[broj]), jer se tada kod ne menja sa mestom naredbe.
+class EncodingCache {
+private:
+	struct Encoding {
+		int value;
+		int size;
+	};
+	unordered_map<string, int> sizes;
+	unordered_map<string, Encoding> encodings;
+
+	long long sizeLookups = 0;
+	long long sizeHits = 0;
+	long long encodeLookups = 0;
+	long long encodeHits = 0;
+	long long notCacheable = 0;	// instrukcije drugog prolaza sa simbolom ili literalom
+
+public:
+	static const size_t MAX_ENTRIES = 1 << 16;	// po tabeli; posle toga se samo trazi
+
+	static string key(const Statement& statement);
+	static bool cacheable(const Statement& statement);
+
+	bool findSize(const string& key, int& size);
+	void addSize(const string& key, int size);
+
+	bool findEncoding(const string& key, int& value, int& size);
+	void addEncoding(const string& key, int value, int size);
+	void skipped() { notCacheable++; }
+
+	void addStats(const EncodingCache& other);	// -j: svaki deo ima svoj kes
+	void report(ostream& os) const;
+
+};
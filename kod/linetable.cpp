@@ -0,0 +1,202 @@
+#include "linetable.h"
+
+#include <algorithm>
+
+
+static void writeUleb(vector<unsigned char>& out, unsigned int value) {
+	do {
+		unsigned char byte = value & 0x7F;
+		value >>= 7;
+		if (value != 0) {
+			byte |= 0x80;
+		}
+		out.push_back(byte);
+	} while (value != 0);
+}
+
+
+static void writeSleb(vector<unsigned char>& out, int value) {
+	bool more = true;
+	while (more) {
+		unsigned char byte = value & 0x7F;
+		value >>= 7;	// aritmeticko pomeranje
+		if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+			more = false;
+		}
+		else {
+			byte |= 0x80;
+		}
+		out.push_back(byte);
+	}
+}
+
+
+static unsigned int readUleb(const unsigned char*& p, const unsigned char* end) {
+	unsigned int value = 0;
+	int shift = 0;
+	while (p < end) {
+		unsigned char byte = *p++;
+		value |= (unsigned int) (byte & 0x7F) << shift;
+		shift += 7;
+		if (!(byte & 0x80)) {
+			break;
+		}
+	}
+	return value;
+}
+
+
+static int readSleb(const unsigned char*& p, const unsigned char* end) {
+	int value = 0;
+	int shift = 0;
+	unsigned char byte = 0;
+	while (p < end) {
+		byte = *p++;
+		value |= (int) (byte & 0x7F) << shift;
+		shift += 7;
+		if (!(byte & 0x80)) {
+			break;
+		}
+	}
+	if (shift < 32 && (byte & 0x40)) {
+		value |= -(1 << shift);
+	}
+	return value;
+}
+
+
+// Poziva se pri kodovanju; belezi se samo prelaz na novu liniju.
+void LineTable::add(const Section* section, int offset, int line) {
+	if (!pending.empty()) {
+		Pending& last = pending.back();
+		if (last.section == section && last.line == line) {
+			return;
+		}
+	}
+	pending.push_back({ section, offset, line });
+}
+
+
+void LineTable::append(const LineTable& other) {
+	for (const Pending& p : other.pending) {
+		add(p.section, p.offset, p.line);
+	}
+}
+
+
+void LineTable::finalize() {
+	stable_sort(pending.begin(), pending.end(), [](const Pending& a, const Pending& b) {
+		return a.section->startAddress + a.offset < b.section->startAddress + b.offset;
+	});
+
+	rows.clear();
+	for (size_t i = 0; i < pending.size(); i++) {
+		const Section* s = pending[i].section;
+		rows.push_back({ s->startAddress + pending[i].offset, pending[i].line });
+		if (i + 1 == pending.size() || pending[i + 1].section != s) {	// kraj sekvence na kraju sekcije
+			rows.push_back({ s->startAddress + s->size(), 0 });
+		}
+	}
+	pending.clear();
+
+	encode();
+}
+
+
+void LineTable::encode() {
+	bytes.clear();
+	bool inSequence = false;
+	int address = 0;
+	int line = 1;
+
+	for (const LineRow& row : rows) {
+		if (!inSequence) {
+			bytes.push_back(SET_ADDRESS);
+			writeUleb(bytes, (unsigned int) row.address);
+			address = row.address;
+			line = 1;
+			inSequence = true;
+		}
+
+		int addressDelta = row.address - address;
+		if (row.line == 0) {
+			if (addressDelta > 0) {
+				bytes.push_back(ADVANCE_PC);
+				writeUleb(bytes, addressDelta);
+			}
+			bytes.push_back(END_SEQUENCE);
+			inSequence = false;
+			continue;
+		}
+
+		int lineDelta = row.line - line;
+		if (lineDelta < LINE_BASE || lineDelta >= LINE_BASE + LINE_RANGE) {
+			bytes.push_back(ADVANCE_LINE);
+			writeSleb(bytes, lineDelta);
+			lineDelta = 0;
+		}
+		int opcode = (lineDelta - LINE_BASE) + LINE_RANGE * addressDelta + OPCODE_BASE;
+		if (addressDelta < 0 || opcode > 255) {
+			bytes.push_back(ADVANCE_PC);
+			writeUleb(bytes, addressDelta);
+			opcode = (lineDelta - LINE_BASE) + OPCODE_BASE;
+		}
+		bytes.push_back((unsigned char) opcode);
+
+		address = row.address;
+		line = row.line;
+	}
+}
+
+
+void LineTable::load(const unsigned char* program, size_t size) {
+	rows.clear();
+	bytes.assign(program, program + size);
+
+	const unsigned char* p = program;
+	const unsigned char* end = program + size;
+	int address = 0;
+	int line = 1;
+
+	while (p < end) {
+		unsigned char opcode = *p++;
+		switch (opcode) {
+		case SET_ADDRESS: {
+			address = (int) readUleb(p, end);
+			line = 1;
+			break;
+		}
+		case ADVANCE_PC: {
+			address += (int) readUleb(p, end);
+			break;
+		}
+		case ADVANCE_LINE: {
+			line += readSleb(p, end);
+			break;
+		}
+		case END_SEQUENCE: {
+			rows.push_back({ address, 0 });
+			break;
+		}
+		default: {
+			int adjusted = opcode - OPCODE_BASE;
+			address += adjusted / LINE_RANGE;
+			line += LINE_BASE + adjusted % LINE_RANGE;
+			rows.push_back({ address, line });
+			break;
+		}
+		}
+	}
+}
+
+
+int LineTable::lookup(int address) const {
+	auto it = upper_bound(rows.begin(), rows.end(), address, [](int a, const LineRow& row) {
+		return a < row.address;
+	});
+	if (it == rows.begin()) {
+		return -1;
+	}
+	--it;
+	return (it->line != 0) ? it->line : -1;
+}
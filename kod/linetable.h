@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+#include "section.h"
+
+
+using namespace std;
+
+
+
+struct LineRow {
+	int address;
+	int line;	// 0 oznacava kraj sekvence (adresa van koda)
+};
+
+
+// Tabela adresa -> linija izvornog koda.
+// Cuva se kao delta-kodiran program u stilu DWARF .debug_line:
+// specijalni opkod pomera adresu i liniju jednim bajtom.
+class LineTable {
+private:
+	struct Pending {
+		const Section* section;
+		int offset;
+		int line;
+	};
+	vector<Pending> pending;
+
+	vector<LineRow> rows;	// sortirano po adresi
+	vector<unsigned char> bytes;
+
+	void encode();
+
+public:
+	static const int LINE_BASE = -3;
+	static const int LINE_RANGE = 12;
+	static const unsigned char OPCODE_BASE = 4;
+
+	enum Opcode : unsigned char { END_SEQUENCE = 0, SET_ADDRESS = 1, ADVANCE_PC = 2, ADVANCE_LINE = 3 };
+
+	void add(const Section* section, int offset, int line);
+	void append(const LineTable& other);	// redovi other posle ovih, pre finalize
+	void finalize();	// posle dodele adresa sekcijama
+
+	void load(const unsigned char* program, size_t size);
+	int lookup(int address) const;	// O(log n), -1 ako adresa nije pokrivena
+
+	const vector<unsigned char>& program() const { return bytes; }
+	size_t rowCount() const { return rows.size(); }
+
+};
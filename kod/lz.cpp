@@ -0,0 +1,340 @@
+#include "lz.h"
+
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+
+
+namespace {
+
+const int MIN_MATCH = 4;
+const int LAST_LITERALS = 5;	// kraj bloka su uvek literali
+const int MATCH_LIMIT = 12;	// poklapanje ne pocinje u poslednjih 12 bajtova
+const int HASH_BITS = 14;
+
+
+inline uint32_t read32(const char* p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+
+inline uint32_t hash4(uint32_t v) {
+	return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+
+inline void writeLength(char*& op, int length) {
+	while (length >= 255) {
+		*op++ = (char) 255;
+		length -= 255;
+	}
+	*op++ = (char) length;
+}
+
+
+bool writeAll(int fd, const char* data, size_t size) {
+	while (size > 0) {
+		ssize_t n = write(fd, data, size);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+
+bool readAll(int fd, char* data, size_t size, off_t offset) {
+	while (size > 0) {
+		ssize_t n = pread(fd, data, size, offset);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		size -= n;
+		offset += n;
+	}
+	return true;
+}
+
+
+void putLittleEndian32(char* p, uint32_t value) {
+	for (int i = 0; i < 4; i++) {
+		p[i] = (char) (value >> (i * 8));
+	}
+}
+
+
+uint32_t getLittleEndian32(const char* p) {
+	const unsigned char* b = (const unsigned char*) p;
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+}
+
+
+
+// Pohlepno trazenje: hes tabela pamti poslednju poziciju svake cetvorke bajtova.
+// Posle niza promasaja korak se povecava, pa se nekompresibilan ulaz brzo preskace.
+int Lz::compressBlock(const char* in, int size, char* out) {
+	char* op = out;
+	const char* anchor = in;	// pocetak literala koji jos nisu upisani
+
+	if (size > MATCH_LIMIT) {
+		int table[1 << HASH_BITS];
+		memset(table, -1, sizeof(table));
+
+		const char* ip = in;
+		const char* matchLimit = in + size - MATCH_LIMIT;
+		const char* matchEnd = in + size - LAST_LITERALS;
+		int misses = 1 << 6;
+
+		while (ip < matchLimit) {
+			uint32_t sequence = read32(ip);
+			uint32_t h = hash4(sequence);
+			int candidate = table[h];
+			table[h] = (int) (ip - in);
+
+			if (candidate < 0 || read32(in + candidate) != sequence) {
+				ip += misses++ >> 6;
+				continue;
+			}
+			misses = 1 << 6;
+
+			const char* match = in + candidate;
+			while (ip > anchor && match > in && ip[-1] == match[-1]) {	// prosirenje unazad
+				ip--;
+				match--;
+			}
+
+			const char* end = ip + MIN_MATCH;
+			const char* ref = match + MIN_MATCH;
+			while (end < matchEnd && *end == *ref) {
+				end++;
+				ref++;
+			}
+
+			int literals = (int) (ip - anchor);
+			int matchLength = (int) (end - ip) - MIN_MATCH;
+			char* token = op++;
+			*token = (char) (((literals >= 15) ? 15 : literals) << 4);
+			if (literals >= 15) {
+				writeLength(op, literals - 15);
+			}
+			memcpy(op, anchor, literals);
+			op += literals;
+
+			int offset = (int) (ip - match);
+			*op++ = (char) (offset & 0xFF);
+			*op++ = (char) (offset >> 8);
+
+			*token |= (char) ((matchLength >= 15) ? 15 : matchLength);
+			if (matchLength >= 15) {
+				writeLength(op, matchLength - 15);
+			}
+
+			ip = end;
+			anchor = ip;
+			if (ip - 2 >= in) {	// pozicija unutar poklapanja, da bi se ponavljanja nasla ranije
+				table[hash4(read32(ip - 2))] = (int) (ip - 2 - in);
+			}
+		}
+	}
+
+	int literals = (int) (in + size - anchor);
+	*op++ = (char) (((literals >= 15) ? 15 : literals) << 4);
+	if (literals >= 15) {
+		writeLength(op, literals - 15);
+	}
+	memcpy(op, anchor, literals);
+	op += literals;
+
+	return (int) (op - out);
+}
+
+
+int Lz::decompressBlock(const char* in, int size, char* out, int capacity) {
+	const unsigned char* ip = (const unsigned char*) in;
+	const unsigned char* inEnd = ip + size;
+	char* op = out;
+	char* outEnd = out + capacity;
+
+	while (ip < inEnd) {
+		int token = *ip++;
+
+		int literals = token >> 4;
+		if (literals == 15) {
+			int b;
+			do {
+				if (ip >= inEnd) {
+					return -1;
+				}
+				b = *ip++;
+				literals += b;
+			} while (b == 255);
+		}
+		if (literals > inEnd - ip || literals > outEnd - op) {
+			return -1;
+		}
+		memcpy(op, ip, literals);
+		op += literals;
+		ip += literals;
+
+		if (ip >= inEnd) {	// poslednja sekvenca
+			break;
+		}
+
+		if (inEnd - ip < 2) {
+			return -1;
+		}
+		int offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > op - out) {
+			return -1;
+		}
+
+		int matchLength = token & 15;
+		if (matchLength == 15) {
+			int b;
+			do {
+				if (ip >= inEnd) {
+					return -1;
+				}
+				b = *ip++;
+				matchLength += b;
+			} while (b == 255);
+		}
+		matchLength += MIN_MATCH;
+		if (matchLength > outEnd - op) {
+			return -1;
+		}
+
+		const char* match = op - offset;
+		if (offset >= matchLength) {
+			memcpy(op, match, matchLength);
+			op += matchLength;
+		}
+		else {	// preklapanje: kopija bajt po bajt ponavlja uzorak
+			for (int i = 0; i < matchLength; i++) {
+				*op++ = *match++;
+			}
+		}
+	}
+
+	return (int) (op - out);
+}
+
+
+// Blok koji se ne smanji upisuje se nekompresovan.
+bool Lz::writeFrame(int fd, const char* data, size_t size) {
+	if (!writeAll(fd, LZ_MAGIC, 4)) {
+		return false;
+	}
+
+	vector<char> buffer(8 + maxCompressedSize(BLOCK_SIZE));
+	for (size_t start = 0; start < size; start += BLOCK_SIZE) {
+		int length = (int) ((size - start < (size_t) BLOCK_SIZE) ? (size - start) : BLOCK_SIZE);
+		int compressed = compressBlock(data + start, length, &buffer[8]);
+		uint32_t stored = (uint32_t) compressed;
+		if (compressed >= length) {
+			memcpy(&buffer[8], data + start, length);
+			compressed = length;
+			stored = (uint32_t) length | 0x80000000u;
+		}
+		putLittleEndian32(&buffer[0], stored);
+		putLittleEndian32(&buffer[4], (uint32_t) length);
+		if (!writeAll(fd, buffer.data(), 8 + compressed)) {
+			return false;
+		}
+	}
+
+	char end[8] = { 0 };
+	return writeAll(fd, end, sizeof(end));
+}
+
+
+
+LzReader::LzReader(int f, off_t start) : fd(f), position(start + 4), compressed(Lz::maxCompressedSize(Lz::BLOCK_SIZE)), block(Lz::BLOCK_SIZE) {
+	char magic[4];
+	if (!readAll(fd, magic, 4, start) || !Lz::isFrame(magic)) {
+		failed = true;
+	}
+}
+
+
+bool LzReader::nextBlock() {
+	char header[8];
+	if (!readAll(fd, header, 8, position)) {
+		failed = true;
+		return false;
+	}
+	position += 8;
+
+	uint32_t stored = getLittleEndian32(header);
+	uint32_t length = getLittleEndian32(header + 4);
+	bool raw = (stored & 0x80000000u) != 0;
+	stored &= 0x7FFFFFFFu;
+
+	if (stored == 0 && length == 0) {
+		finished = true;
+		return false;
+	}
+	if (length > (uint32_t) Lz::BLOCK_SIZE || stored > compressed.size() || (raw && stored != length)) {
+		failed = true;
+		return false;
+	}
+
+	if (raw) {
+		if (!readAll(fd, block.data(), length, position)) {
+			failed = true;
+			return false;
+		}
+	}
+	else if (!readAll(fd, compressed.data(), stored, position)
+		|| Lz::decompressBlock(compressed.data(), (int) stored, block.data(), (int) length) != (int) length) {
+		failed = true;
+		return false;
+	}
+	position += stored;
+
+	blockStart = 0;
+	blockLength = length;
+	return true;
+}
+
+
+size_t LzReader::read(char* out, size_t n) {
+	size_t done = 0;
+	while (done < n && !failed) {
+		if (blockStart == blockLength) {
+			if (finished || !nextBlock()) {
+				break;
+			}
+		}
+		size_t chunk = blockLength - blockStart;
+		if (chunk > n - done) {
+			chunk = n - done;
+		}
+		if (out) {
+			memcpy(out + done, &block[blockStart], chunk);
+		}
+		blockStart += chunk;
+		done += chunk;
+	}
+	return done;
+}
+
+
+bool LzReader::skip(size_t n) {
+	return read(nullptr, n) == n;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+using namespace std;
+
+
+
+// Blok kompresija u stilu LZ4, bez spoljnih biblioteka. Ulaz se deli na blokove od 64 KB;
+// blok je niz sekvenci: token (gornja 4 bita broj literala, donja 4 duzina poklapanja - 4),
+// produzenja duzina bajtovima 255, literali, pa pomeraj poklapanja (2 B, little-endian).
+// Poslednja sekvenca bloka ima samo literale.
+//
+// Okvir (-z):	"ESSZ", pa blokovi: kompresovana velicina (4 B, najvisi bit: blok je
+//	sacuvan nekompresovan), velicina posle dekompresije (4 B), sadrzaj; kraj je blok 0/0.
+
+const char LZ_MAGIC[4] = { 'E', 'S', 'S', 'Z' };
+
+
+class Lz {
+public:
+	static const int BLOCK_SIZE = 1 << 16;
+
+	static int maxCompressedSize(int size) { return size + size / 255 + 16; }
+
+	static int compressBlock(const char* in, int size, char* out);	// vraca velicinu izlaza
+	static int decompressBlock(const char* in, int size, char* out, int capacity);	// -1 za neispravan blok
+
+	static bool writeFrame(int fd, const char* data, size_t size);
+
+	static bool isFrame(const char* header) { return header[0] == LZ_MAGIC[0] && header[1] == LZ_MAGIC[1] && header[2] == LZ_MAGIC[2] && header[3] == LZ_MAGIC[3]; }
+};
+
+
+// Dekompresija okvira blok po blok iz fajla; u memoriji je samo tekuci blok.
+class LzReader {
+private:
+	int fd;
+	off_t position;	// u kompresovanom fajlu
+	vector<char> compressed;
+	vector<char> block;
+	size_t blockStart = 0;	// procitano iz tekuceg bloka
+	size_t blockLength = 0;
+	bool finished = false;
+	bool failed = false;
+
+	bool nextBlock();
+
+public:
+	LzReader(int f, off_t start = 0);	// start: pocetak okvira (magic) u fajlu
+
+	bool ok() const { return !failed; }
+
+	size_t read(char* out, size_t n);	// manje od n samo na kraju ili posle greske
+	bool skip(size_t n);
+
+};
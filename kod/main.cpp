@@ -1,36 +1,221 @@
-#include <iostream>
-#include <fstream>
-
-#include "assembler.h"
-
-
-using namespace std;
-
-
-int main(int argc, char *argv[]) {
-
-	if (argc < 4) {
-		cout << endl << "Insufficient number of command line parameters." << endl;
-		return 2;
-	}
-
-	char* inputFileName = argv[1];
-	ifstream ifs(inputFileName);
-	if (!ifs || !ifs.is_open()) {
-		cout << endl << "Error opening input file: " << inputFileName << endl;
-		return 2;
-	}
-
-	char* outputFileName = argv[2];
-	ofstream ofs(outputFileName);
-	if (!ofs || !ofs.is_open()) {
-		cout << endl << "Error opening output file: " << outputFileName << endl;
-		return 2;
-	}
-
-	int startAddress = atoi(argv[3]);
-
-
-	Assembler a;
-	a.assemble(ifs, ofs, startAddress);
-}
\ No newline at end of file
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "assembler.h"
+#include "lz.h"
+
+
+using namespace std;
+
+
+// Posle neuspeha se poruke ispisuju i ceka se na unos, kao ranije.
+static void printErrors(const Result& result) {
+	if (result.errors.size() > 0) {
+		for (const string& error : result.errors) {
+			cout << error << endl;
+		}
+
+		int x;
+		cin >> x;
+	}
+}
+
+
+// Upozorenja posle uspesnog prevodjenja idu na stderr, bez cekanja, da skripte ne bi stale.
+static void printWarnings(const Result& result) {
+	for (const string& warning : result.errors) {
+		cerr << warning << endl;
+	}
+}
+
+
+int main(int argc, char *argv[]) {
+
+	if (argc < 4) {
+		cout << endl << "Insufficient number of command line parameters." << endl;
+		cout << "Usage: " << argv[0] << " input output startAddress [-f listing|bin|obj] [-g lineProgramFile] [-O] [--absolute] [--page-size n] [-D name[=value]]... [-z] [-P] [-j n] [--cache-stats] [--relr] [--layout [--profile file]]" << endl;
+		return 2;
+	}
+
+	Options options;
+	enum { LISTING, FLAT_BINARY, OBJECT } format = LISTING;
+	char* lineProgramFileName = nullptr;
+	bool compress = false;
+	bool pipeline = false;
+	for (int i = 4; i < argc; i++) {
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "bin") == 0) {
+				format = FLAT_BINARY;
+			}
+			else if (strcmp(argv[i], "obj") == 0) {
+				format = OBJECT;
+			}
+			else if (strcmp(argv[i], "listing") != 0) {
+				cout << endl << "Unknown output format: " << argv[i] << endl;
+				return 2;
+			}
+		}
+		else if (strcmp(argv[i], "-O") == 0) {
+			options.optimize = true;
+		}
+		else if (strcmp(argv[i], "--layout") == 0) {
+			options.layout = true;
+		}
+		else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			options.profile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--cache-stats") == 0) {
+			options.cacheStats = true;
+		}
+		else if (strcmp(argv[i], "--relr") == 0) {
+			options.compactRelocations = true;
+		}
+		else if (strcmp(argv[i], "--absolute") == 0) {
+			options.absolute = true;
+		}
+		else if (strcmp(argv[i], "--page-size") == 0 && i + 1 < argc) {
+			options.pageSize = atoi(argv[++i]);
+			if (options.pageSize <= 0) {
+				cout << endl << "Bad page size: " << argv[i] << endl;
+				return 2;
+			}
+		}
+		else if (strncmp(argv[i], "-D", 2) == 0 && (argv[i][2] != '\0' || i + 1 < argc)) {
+			string define = (argv[i][2] != '\0') ? (argv[i] + 2) : argv[++i];
+			size_t eq = define.find('=');
+			if (eq == string::npos) {
+				options.defines[define] = 1;
+			}
+			else {
+				string value = define.substr(eq + 1);
+				size_t end = 0;
+				try {
+					options.defines[define.substr(0, eq)] = stoi(value, &end, 0);
+				}
+				catch (logic_error&) {	// invalid_argument ili out_of_range
+					end = 0;
+				}
+				if (value.empty() || end != value.size()) {
+					cout << endl << "Bad value for -D " << define.substr(0, eq) << ": " << value << endl;
+					return 2;
+				}
+			}
+		}
+		else if (strcmp(argv[i], "-z") == 0) {
+			compress = true;
+		}
+		else if (strcmp(argv[i], "-P") == 0) {
+			pipeline = true;
+		}
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			options.jobs = atoi(argv[++i]);
+			if (options.jobs <= 0) {
+				cout << endl << "Bad number of jobs: " << argv[i] << endl;
+				return 2;
+			}
+		}
+		else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+			lineProgramFileName = argv[++i];
+		}
+		else {
+			cout << endl << "Unknown command line parameter: " << argv[i] << endl;
+			return 2;
+		}
+	}
+
+	if (pipeline) {
+		options.pipeline = (format == LISTING) ? 3 : 2;	// treca nit formatira listing
+	}
+
+	char* inputFileName = argv[1];
+	ifstream ifs(inputFileName, ios::binary);
+	if (!ifs || !ifs.is_open()) {
+		cout << endl << "Error opening input file: " << inputFileName << endl;
+		return 2;
+	}
+	stringstream buffer;
+	buffer << ifs.rdbuf();
+	string source = buffer.str();
+
+	char* outputFileName = argv[2];
+	options.startAddress = atoi(argv[3]);
+
+
+	Result result = assemble(source, options);
+	cout << result.report;
+
+	if (!result.success) {
+		printErrors(result);
+		return 1;
+	}
+
+	if (compress) {
+		// izlaz se pravi u memoriji (bin i obj preko privremenog fajla, zbog pwrite), pa se kompresuje
+		string image;
+		bool written = true;
+		if (format != LISTING) {
+			FILE* temporary = tmpfile();
+			written = temporary && ((format == OBJECT) ? result.writeObject(fileno(temporary)) : result.writeFlatBinary(fileno(temporary)));
+			if (written) {
+				off_t size = lseek(fileno(temporary), 0, SEEK_END);
+				image.resize(size);
+				written = size >= 0 && pread(fileno(temporary), &image[0], size, 0) == size;
+			}
+			if (temporary) {
+				fclose(temporary);
+			}
+		}
+		else {
+			ostringstream oss;
+			result.print(oss);
+			image = oss.str();
+		}
+
+		int fd = open(outputFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			cout << endl << "Error opening output file: " << outputFileName << endl;
+			return 2;
+		}
+		written = written && Lz::writeFrame(fd, image.data(), image.size());
+		close(fd);
+		if (!written) {
+			cout << endl << "Output write error: " << outputFileName << endl;
+			return 2;
+		}
+	}
+	else if (format != LISTING) {
+		int fd = open(outputFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			cout << endl << "Error opening output file: " << outputFileName << endl;
+			return 2;
+		}
+		bool written = (format == OBJECT) ? result.writeObject(fd) : result.writeFlatBinary(fd);
+		close(fd);
+		if (!written) {
+			cout << endl << "Output write error: " << outputFileName << endl;
+			return 2;
+		}
+	}
+	else {
+		ofstream ofs(outputFileName);
+		if (!ofs || !ofs.is_open()) {
+			cout << endl << "Error opening output file: " << outputFileName << endl;
+			return 2;
+		}
+		result.print(ofs);
+	}
+
+	if (lineProgramFileName && !result.writeLineProgram(lineProgramFileName)) {
+		cout << endl << "Error writing line program: " << lineProgramFileName << endl;
+		return 2;
+	}
+
+	printWarnings(result);
+}
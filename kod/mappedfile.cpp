@@ -0,0 +1,62 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+MappedFile::MappedFile(const string n) : name(n) {
+#ifdef _WIN32
+	// bez mmap-a: fajl se ucitava jednom, i dalje bez kopija po bajtu/entry-ju
+	ifstream ifs(name, ios::binary | ios::ate);
+	if (!ifs) {
+		return;
+	}
+	length = (size_t) ifs.tellg();
+	ifs.seekg(0, ios::beg);
+	if (length > 0) {
+		char* buffer = new char[length];
+		ifs.read(buffer, length);
+		bytes = buffer;
+	}
+	opened = true;
+#else
+	int fd = open(name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return;
+	}
+	length = (size_t) st.st_size;
+	if (length > 0) {
+		void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			close(fd);
+			length = 0;
+			return;
+		}
+		bytes = (const char*) p;
+	}
+	close(fd);	// mapiranje ostaje validno i posle zatvaranja
+	opened = true;
+#endif
+}
+
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	delete[] bytes;
+#else
+	if (bytes) {
+		munmap((void*) bytes, length);
+	}
+#endif
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+
+using namespace std;
+
+
+
+// Fajl mapiran u memoriju (samo za citanje). Bajtovi se ne kopiraju,
+// sekcije cuvaju pokazivace direktno u mapiranje.
+class MappedFile {
+private:
+	bool opened = false;
+	const char* bytes = nullptr;
+	size_t length = 0;
+
+public:
+	const string name;
+
+	MappedFile(const string n);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool isOpen() const { return opened; }
+	const char* data() const { return bytes; }
+	size_t size() const { return length; }
+
+};
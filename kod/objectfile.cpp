@@ -0,0 +1,287 @@
+#include "objectfile.h"
+#include "lz.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+ObjectFile::ObjectFile(const string n) : name(n) {
+	int fd = open(name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		fail("Error opening object file: " + name);
+		return;
+	}
+	opened = load(fd);
+	close(fd);	// mapiranja ostaju validna i posle zatvaranja
+}
+
+
+ObjectFile::~ObjectFile() {
+	for (size_t i = 0; i < loaded.size(); i++) {
+		if (loaded[i].data) {
+			munmap(loaded[i].data, lengths[i]);
+		}
+	}
+}
+
+
+bool ObjectFile::fail(const string& description) {
+	message = description;
+	return false;
+}
+
+
+bool ObjectFile::load(int fd) {
+	char header[OBJECT_HEADER_SIZE];
+	if (pread(fd, header, 4, 0) == 4 && Lz::isFrame(header)) {
+		return loadCompressed(fd);
+	}
+	if (pread(fd, header, sizeof(header), 0) != (ssize_t) sizeof(header) || memcmp(header, OBJECT_MAGIC, 4) != 0) {
+		return fail("Not an object file: " + name);
+	}
+	if (getLittleEndian(header + 4) != OBJECT_VERSION) {
+		return fail("Unsupported object file version: " + name);
+	}
+	uint32_t count = getLittleEndian(header + 12);
+
+	vector<char> table(count * OBJECT_SECTION_SIZE);
+	if (pread(fd, table.data(), table.size(), OBJECT_HEADER_SIZE) != (ssize_t) table.size()) {
+		return fail("Truncated section table: " + name);
+	}
+
+	long hostPage = sysconf(_SC_PAGESIZE);
+
+	for (uint32_t i = 0; i < count; i++) {
+		const char* entry = &table[i * OBJECT_SECTION_SIZE];
+		LoadedSection s;
+		s.name = string(entry, strnlen(entry, 8));
+		s.address = getLittleEndian(entry + 8);
+		s.size = getLittleEndian(entry + 12);
+		uint32_t fileOffset = getLittleEndian(entry + 16);
+		s.flags = getLittleEndian(entry + 20);
+
+		int protection = PROT_READ;
+		if (s.flags & SECTION_WRITE) {
+			protection |= PROT_WRITE;
+		}
+		if (s.flags & SECTION_EXEC) {
+			protection |= PROT_EXEC;
+		}
+
+		loaded.push_back(s);
+		lengths.push_back(s.size);
+		if (s.size == 0) {
+			continue;
+		}
+
+		void* p;
+		if (s.flags & SECTION_NOBITS) {
+			p = mmap(nullptr, s.size, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		}
+		else if (fileOffset % hostPage == 0) {	// bez kopiranja; MAP_PRIVATE daje kopiju stranice tek pri upisu
+			p = mmap(nullptr, s.size, protection, MAP_PRIVATE, fd, fileOffset);
+		}
+		else {	// fajl je pisan sa manjom stranicom od sistemske
+			p = mmap(nullptr, s.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (p != MAP_FAILED) {
+				if (pread(fd, p, s.size, fileOffset) != (ssize_t) s.size || mprotect(p, s.size, protection) != 0) {
+					munmap(p, s.size);
+					return fail("Error reading section " + s.name + ": " + name);
+				}
+				loaded.back().copied = true;
+			}
+		}
+		if (p == MAP_FAILED) {
+			return fail("Error mapping section " + s.name + ": " + name);
+		}
+		loaded.back().data = (char*) p;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		return fail("Error reading object file: " + name);
+	}
+	vector<char> tables[OBJECT_TABLES];
+	for (int k = 0; k < OBJECT_TABLES; k++) {
+		uint32_t offset = getLittleEndian(header + 16 + 8 * k);
+		uint32_t size = getLittleEndian(header + 20 + 8 * k);
+		if ((uint64_t) offset + size > (uint64_t) st.st_size) {
+			return fail("Truncated object file tables: " + name);
+		}
+		tables[k].resize(size);
+		if (size > 0 && pread(fd, tables[k].data(), size, offset) != (ssize_t) size) {
+			return fail("Truncated object file tables: " + name);
+		}
+	}
+	return loadTables(tables);
+}
+
+
+// Fajl pisan sa -z: raspakuje se redom, sekcija po sekcija, direktno u anonimnu memoriju.
+// Praznine do poravnatih pomeraja se preskacu bez kopiranja, pa ceo fajl nikad nije u memoriji.
+bool ObjectFile::loadCompressed(int fd) {
+	LzReader reader(fd);
+	char header[OBJECT_HEADER_SIZE];
+	if (reader.read(header, sizeof(header)) != sizeof(header) || memcmp(header, OBJECT_MAGIC, 4) != 0) {
+		return fail("Not an object file: " + name);
+	}
+	if (getLittleEndian(header + 4) != OBJECT_VERSION) {
+		return fail("Unsupported object file version: " + name);
+	}
+	uint32_t count = getLittleEndian(header + 12);
+
+	vector<char> table(count * OBJECT_SECTION_SIZE);
+	if (reader.read(table.data(), table.size()) != table.size()) {
+		return fail("Truncated section table: " + name);
+	}
+	size_t position = OBJECT_HEADER_SIZE + table.size();
+
+	vector<uint32_t> offsets(count);
+	for (uint32_t i = 0; i < count; i++) {
+		const char* entry = &table[i * OBJECT_SECTION_SIZE];
+		LoadedSection s;
+		s.name = string(entry, strnlen(entry, 8));
+		s.address = getLittleEndian(entry + 8);
+		s.size = getLittleEndian(entry + 12);
+		offsets[i] = getLittleEndian(entry + 16);
+		s.flags = getLittleEndian(entry + 20);
+		s.copied = !(s.flags & SECTION_NOBITS) && s.size > 0;
+		loaded.push_back(s);
+		lengths.push_back(s.size);
+	}
+
+	vector<uint32_t> order(count);	// citanje ide samo unapred
+	for (uint32_t i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return offsets[a] < offsets[b]; });
+
+	for (uint32_t i : order) {
+		LoadedSection& s = loaded[i];
+		if (s.size == 0) {
+			continue;
+		}
+
+		int protection = PROT_READ;
+		if (s.flags & SECTION_WRITE) {
+			protection |= PROT_WRITE;
+		}
+		if (s.flags & SECTION_EXEC) {
+			protection |= PROT_EXEC;
+		}
+
+		void* p = mmap(nullptr, s.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			return fail("Error mapping section " + s.name + ": " + name);
+		}
+		s.data = (char*) p;
+		if (!(s.flags & SECTION_NOBITS)) {
+			if (offsets[i] < position || !reader.skip(offsets[i] - position) || reader.read(s.data, s.size) != s.size) {
+				return fail("Error reading section " + s.name + ": " + name);
+			}
+			position = offsets[i] + s.size;
+		}
+		if (mprotect(p, s.size, protection) != 0) {
+			return fail("Error mapping section " + s.name + ": " + name);
+		}
+	}
+
+	vector<char> tables[OBJECT_TABLES];	// iza svih sekcija, redom
+	for (int k = 0; k < OBJECT_TABLES; k++) {
+		uint32_t offset = getLittleEndian(header + 16 + 8 * k);
+		uint32_t size = getLittleEndian(header + 20 + 8 * k);
+		if (size == 0) {
+			continue;
+		}
+		if (offset < position || !reader.skip(offset - position)) {
+			return fail("Truncated object file tables: " + name);
+		}
+		while (tables[k].size() < size) {	// velicina iz zaglavlja se ne zauzima unapred, fajl moze biti krai
+			size_t done = tables[k].size();
+			size_t n = min((size_t) size - done, (size_t) Lz::BLOCK_SIZE);
+			tables[k].resize(done + n);
+			if (reader.read(&tables[k][done], n) != n) {
+				return fail("Truncated object file tables: " + name);
+			}
+		}
+		position = offset + size;
+	}
+	return loadTables(tables);
+}
+
+
+bool ObjectFile::loadTables(vector<char> tables[OBJECT_TABLES]) {
+	strings = move(tables[TABLE_STRINGS]);
+	if (!strings.empty() && strings.back() != '\0') {
+		return fail("Corrupt string table: " + name);
+	}
+
+	const vector<char>& symbolTable = tables[TABLE_SYMBOLS];
+	if (symbolTable.size() % OBJECT_SYMBOL_SIZE != 0) {
+		return fail("Corrupt symbol table: " + name);
+	}
+	for (size_t i = 0; i < symbolTable.size(); i += OBJECT_SYMBOL_SIZE) {
+		const char* entry = &symbolTable[i];
+		uint32_t nameOffset = getLittleEndian(entry);
+		LoadedSymbol symbol;
+		symbol.section = getLittleEndian(entry + 4);
+		symbol.value = getLittleEndian(entry + 8);
+		symbol.global = (getLittleEndian(entry + 12) & SYMBOL_GLOBAL) != 0;
+		if (nameOffset >= strings.size() || (symbol.section >= loaded.size() && symbol.section != OBJECT_UNDEFINED)) {
+			return fail("Corrupt symbol table: " + name);
+		}
+		symbol.name = &strings[nameOffset];
+		symbolList.push_back(symbol);
+	}
+
+	const vector<char>& block = tables[TABLE_RELOCATIONS];
+	relocationBlock = (uint32_t) block.size();
+	if (block.empty()) {
+		return true;
+	}
+	if (!RelocationTable::parse(block.data(), block.size(), relocationList)) {
+		return fail("Corrupt relocation table: " + name);
+	}
+	for (const LoadedRelocation& r : relocationList) {
+		if (r.section >= loaded.size() || r.offset >= loaded[r.section].size || r.symbol >= symbolList.size()) {
+			return fail("Bad relocation (section, offset or symbol): " + name);
+		}
+	}
+	return true;
+}
+
+
+const LoadedSection* ObjectFile::find(const string& sectionName) const {
+	for (const LoadedSection& s : loaded) {
+		if (s.name == sectionName) {
+			return &s;
+		}
+	}
+	return nullptr;
+}
+
+
+size_t ObjectFile::copiedBytes() const {
+	size_t total = 0;
+	for (const LoadedSection& s : loaded) {
+		if (s.copied) {
+			total += s.size;
+		}
+	}
+	return total;
+}
+
+
+const LoadedSymbol* ObjectFile::findSymbol(string_view symbolName) const {
+	for (const LoadedSymbol& s : symbolList) {
+		if (symbolName == s.name) {
+			return &s;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "relocationtable.h"
+
+
+using namespace std;
+
+
+
+// Format izlaza -f obj: zaglavlje i tabela sekcija na pocetku fajla, sadrzaj svake
+// sekcije na pomeraju poravnatom na velicinu stranice, pa se sekcija moze mapirati
+// direktno iz fajla. Iza sadrzaja sekcija su, redom, blok relokacija (vidi relocationtable.h),
+// tabela simbola i tabela imena (vidi stringtable.h). Sva polja su little-endian.
+//
+//	zaglavlje (40 B):	magic "ESSO", verzija, velicina stranice, broj sekcija,
+//		pa pomeraj i velicina bloka relokacija, tabele simbola i tabele imena
+//	sekcija (24 B):	ime (8 B, dopunjeno nulama), adresa, velicina, pomeraj u fajlu, flegovi
+//	simbol (16 B):	pomeraj imena u tabeli imena, indeks sekcije (OBJECT_UNDEFINED za nedefinisan), vrednost, flegovi
+//
+// Simboli su redom indeksa iz listinga, pa relokacije pokazuju na njih istim indeksom.
+
+const char OBJECT_MAGIC[4] = { 'E', 'S', 'S', 'O' };
+const uint32_t OBJECT_VERSION = 3;
+const int OBJECT_HEADER_SIZE = 40;
+const int OBJECT_SECTION_SIZE = 24;
+const int OBJECT_SYMBOL_SIZE = 16;
+const uint32_t OBJECT_UNDEFINED = 0xFFFFFFFF;
+
+enum ObjectTable { TABLE_RELOCATIONS, TABLE_SYMBOLS, TABLE_STRINGS, OBJECT_TABLES };	// redom u fajlu
+
+enum ObjectSectionFlags : uint32_t { SECTION_READ = 1, SECTION_WRITE = 2, SECTION_EXEC = 4, SECTION_NOBITS = 8 };
+enum ObjectSymbolFlags : uint32_t { SYMBOL_GLOBAL = 1 };
+
+
+inline void putLittleEndian(char* p, uint32_t value) {
+	for (int i = 0; i < 4; i++) {
+		p[i] = (char) (value >> (i * 8));
+	}
+}
+
+
+inline uint32_t getLittleEndian(const char* p) {
+	const unsigned char* b = (const unsigned char*) p;
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+
+struct LoadedSection {
+	string name;
+	uint32_t address;
+	uint32_t size;
+	uint32_t flags;
+	char* data = nullptr;	// nullptr za praznu sekciju
+	bool copied = false;	// pomeraj nije poravnat na stranicu sistema ili je fajl kompresovan, sadrzaj je procitan
+};
+
+
+struct LoadedSymbol {
+	const char* name;	// u tabeli imena; isto ime je uvek isti pokazivac
+	uint32_t section;	// indeks u tabeli sekcija ili OBJECT_UNDEFINED
+	uint32_t value;
+	bool global;
+};
+
+
+// Ucitava -f obj fajl: text se mapira za citanje i izvrsavanje, rodata samo za citanje,
+// data kao privatno mapiranje (kopija tek pri upisu), bss kao anonimna memorija.
+// Kompresovan fajl (-z) se prepoznaje po magic broju i raspakuje u anonimnu memoriju.
+class ObjectFile {
+private:
+	bool opened = false;
+	string message;
+	vector<LoadedSection> loaded;
+	vector<size_t> lengths;	// duzine mapiranja, za munmap
+	vector<LoadedRelocation> relocationList;
+	uint32_t relocationBlock = 0;	// velicina bloka u fajlu
+	vector<LoadedSymbol> symbolList;
+	vector<char> strings;
+
+	bool load(int fd);
+	bool loadCompressed(int fd);
+	bool loadTables(vector<char> tables[OBJECT_TABLES]);
+	bool fail(const string& description);
+
+public:
+	const string name;
+
+	ObjectFile(const string n);
+	~ObjectFile();
+
+	ObjectFile(const ObjectFile&) = delete;
+	ObjectFile& operator=(const ObjectFile&) = delete;
+
+	bool isOpen() const { return opened; }
+	const string& error() const { return message; }
+
+	const vector<LoadedSection>& sections() const { return loaded; }
+	const LoadedSection* find(const string& sectionName) const;
+
+	const vector<LoadedRelocation>& relocations() const { return relocationList; }
+	uint32_t relocationBytes() const { return relocationBlock; }
+
+	const vector<LoadedSymbol>& symbols() const { return symbolList; }
+	const LoadedSymbol* findSymbol(string_view symbolName) const;
+	size_t stringBytes() const { return strings.size(); }
+
+	size_t copiedBytes() const;	// 0 ako je sve mapirano bez kopiranja
+
+};
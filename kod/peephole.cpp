@@ -0,0 +1,236 @@
+#include "peephole.h"
+#include "assembler.h"
+
+
+const vector<PeepholeRule> Peephole::rules = {
+	{ "mov rX, rX",			{ { "mov", "%r1", "%r1" } },						{ },								true },
+	{ "add rX, 0",			{ { "add", "%r1", "%0" } },							{ },								true },
+	{ "sub rX, 0",			{ { "sub", "%r1", "%0" } },							{ },								true },
+	{ "jmp to next label",	{ { "jmp", "%next" } },								{ },								true },
+	{ "push rX; pop rX",	{ { "push", "%r1" }, { "pop", "%r1" } },			{ },								false },
+	{ "push rX; pop rY",	{ { "push", "%r1" }, { "pop", "%r2" } },			{ { "mov", "%r2", "%r1" } },		true }
+};
+
+
+// Razdvaja npr. "moveq" na "mov" i "eq".
+static void splitMnemonic(const string& token, string& base, string& condition) {
+	base = token;
+	condition = "";
+	if (token.size() > 2) {
+		string suffix = token.substr(token.size() - 2);
+		string prefix = token.substr(0, token.size() - 2);
+		if (Instruction::conditionCodes.count(suffix) && Assembler::numberOfOperands(prefix) != ERROR) {
+			base = prefix;
+			condition = suffix;
+		}
+	}
+}
+
+
+static bool isZero(const string& operand) {
+	TokenType type = Assembler::parseToken(operand);
+	return (type == IMM || type == IMM_HEX) && stoi(operand, nullptr, 0) == 0;
+}
+
+
+Peephole::Peephole() : stats(rules.size()) { }
+
+
+int Peephole::instructionSize(const Statement& statement) {
+	for (const string& operand : statement.operands) {
+		if (Instruction::requiresFourBytes(Assembler::parseToken(operand))) {
+			return 4;
+		}
+	}
+	return 2;
+}
+
+
+bool Peephole::match(const PeepholeRule& rule, const vector<Statement>& statements, size_t at, string captures[], string& condition) const {
+	if (at + rule.pattern.size() > statements.size()) {
+		return false;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		captures[i] = "";
+	}
+
+	string next;	// labela koja se trazi iza uzorka
+	for (size_t k = 0; k < rule.pattern.size(); k++) {
+		const Statement& statement = statements[at + k];
+		const vector<string>& pattern = rule.pattern[k];
+
+		if (statement.type != INSTRUCTION || statement.operands.size() != pattern.size() - 1) {	// labela izmedju prekida uzorak
+			return false;
+		}
+
+		string base, cond;
+		splitMnemonic(statement.token, base, cond);
+		if (base != pattern[0] || (k > 0 && cond != condition)) {
+			return false;
+		}
+		condition = cond;
+
+		for (size_t j = 1; j < pattern.size(); j++) {
+			const string& p = pattern[j];
+			const string& operand = statement.operands[j - 1];
+			if (p == "%0") {
+				if (!isZero(operand)) {
+					return false;
+				}
+			}
+			else if (p == "%next") {
+				if (Assembler::parseToken(operand) != SYMBOL) {
+					return false;
+				}
+				next = operand;
+			}
+			else if (p[0] == '%' && p[1] == 'r') {
+				int slot = p[2] - '0';
+				if (Assembler::parseToken(operand) != REGDIR) {
+					return false;
+				}
+				if (captures[slot].empty()) {
+					captures[slot] = operand;
+				}
+				else if (captures[slot] != operand) {
+					return false;
+				}
+			}
+			else if (p != operand) {
+				return false;
+			}
+		}
+	}
+
+	if (!next.empty()) {
+		for (size_t j = at + rule.pattern.size(); j < statements.size() && statements[j].type == LABEL; j++) {
+			if (statements[j].token == next) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	return true;
+}
+
+
+// Da li se flegovi posle naredbe from citaju pre nego sto ih postavi cmp/test, kao u BlockLayout:
+// uslovna naredba i call ih citaju, posle ret ih moze citati pozivalac, a jmp se prati do labele.
+// Promena sekcije i indirektan skok se ne prate, pa se tada flegovi smatraju zivim.
+bool Peephole::flagsLive(const vector<Statement>& statements, size_t from, const unordered_map<string, size_t>& labels) {
+	vector<bool> visited(statements.size(), false);
+	size_t j = from;
+	while (j < statements.size() && !visited[j]) {
+		visited[j] = true;
+		const Statement& statement = statements[j];
+		if (statement.type == SECTION) {
+			return true;
+		}
+		if (statement.type == END) {
+			return false;
+		}
+		if (statement.type != INSTRUCTION) {
+			j++;
+			continue;
+		}
+
+		string base, condition;
+		splitMnemonic(statement.token, base, condition);
+		if ((!condition.empty() && condition != "al") || base == "call" || base == "ret" || base == "iret") {
+			return true;
+		}
+		if (base == "cmp" || base == "test") {
+			return false;
+		}
+		if (base == "jmp") {
+			auto target = labels.find(statement.operands[0]);
+			if (Assembler::parseToken(statement.operands[0]) != SYMBOL || target == labels.end()) {
+				return true;
+			}
+			j = target->second;
+			continue;
+		}
+		j++;
+	}
+	return false;	// kraj koda se ne izvrsava, a petlja bez citanja ne cuva flegove
+}
+
+
+// Radi nad naredbama pre prvog prolaza, pa se ofseti labela i relokacije
+// racunaju vec nad optimizovanim kodom. Ponavlja se dok ima promena,
+// jer brisanje moze da spoji nove parove (npr. push r1; mov r2, r2; pop r1).
+void Peephole::run(vector<Statement>& statements) {
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		vector<Statement> out;
+		out.reserve(statements.size());
+
+		unordered_map<string, size_t> labels;
+		for (size_t j = 0; j < statements.size(); j++) {
+			if (statements[j].type == LABEL) {
+				labels[statements[j].token] = j;
+			}
+		}
+
+		size_t i = 0;
+		while (i < statements.size()) {
+			bool matched = false;
+			for (size_t r = 0; r < rules.size(); r++) {
+				const PeepholeRule& rule = rules[r];
+				string captures[3];
+				string condition;
+				if (!match(rule, statements, i, captures, condition)) {
+					continue;
+				}
+				if (rule.changesFlags && flagsLive(statements, i + rule.pattern.size(), labels)) {
+					continue;
+				}
+
+				int saved = 0;
+				for (size_t k = 0; k < rule.pattern.size(); k++) {
+					saved += instructionSize(statements[i + k]);
+				}
+				for (const vector<string>& templ : rule.replacement) {
+					Statement statement;
+					statement.line = statements[i].line;
+					statement.type = INSTRUCTION;
+					statement.token = templ[0] + condition;
+					for (size_t j = 1; j < templ.size(); j++) {
+						statement.operands.push_back(templ[j][0] == '%' ? captures[templ[j][2] - '0'] : templ[j]);
+					}
+					saved -= instructionSize(statement);
+					out.push_back(statement);
+				}
+
+				stats[r].matches++;
+				stats[r].bytesSaved += saved;
+				i += rule.pattern.size();
+				matched = changed = true;
+				break;
+			}
+
+			if (!matched) {
+				out.push_back(statements[i]);
+				i++;
+			}
+		}
+
+		statements.swap(out);
+	}
+}
+
+
+void Peephole::report(ostream& os) const {
+	int total = 0;
+	os << "PEEPHOLE OPTIMIZATION" << endl << endl;
+	os << "rule" << '\t' << '\t' << '\t' << "matches" << '\t' << "bytes saved" << endl;
+	os << "----" << '\t' << '\t' << '\t' << "-------" << '\t' << "-----------" << endl;
+	for (size_t r = 0; r < rules.size(); r++) {
+		os << rules[r].name << '\t' << '\t' << stats[r].matches << '\t' << stats[r].bytesSaved << endl;
+		total += stats[r].bytesSaved;
+	}
+	os << "total" << '\t' << '\t' << '\t' << '\t' << total << endl << endl;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <unordered_map>
+
+#include "statement.h"
+
+
+using namespace std;
+
+
+
+// Pravilo se zadaje kao niz instrukcija (mnemonika bez uslova, pa operandi).
+// Operandi uzorka:
+//	%r1, %r2	registar (rN), vezuje se za slot; isti slot mora biti isti registar
+//	%0			neposredna nula
+//	%next		labela definisana odmah iza uzorka
+// Sve instrukcije uzorka moraju imati isti uslov, koji se prenosi i na zamenu.
+struct PeepholeRule {
+	const char* name;
+	vector<vector<string>> pattern;
+	vector<vector<string>> replacement;	// prazno: instrukcije se brisu
+	bool changesFlags;	// mov, add, sub i jmp (add r7) postavljaju flegove, pa zamena sme samo ako su mrtvi
+};
+
+
+class Peephole {
+private:
+	struct Stat {
+		int matches = 0;
+		int bytesSaved = 0;
+	};
+	vector<Stat> stats;
+
+	bool match(const PeepholeRule& rule, const vector<Statement>& statements, size_t at, string captures[], string& condition) const;
+	static bool flagsLive(const vector<Statement>& statements, size_t from, const unordered_map<string, size_t>& labels);
+
+public:
+	static const vector<PeepholeRule> rules;
+
+	Peephole();
+
+	void run(vector<Statement>& statements);
+	void report(ostream& os) const;
+
+	static int instructionSize(const Statement& statement);
+
+};
@@ -0,0 +1,134 @@
+#include "relocationtable.h"
+#include "objectfile.h"
+
+#include <map>
+#include <tuple>
+#include <algorithm>
+
+
+bool RelocationTable::build(const vector<LoadedRelocation>& relocations, bool compact, vector<char>& block) {
+	map<tuple<uint32_t, uint32_t, uint32_t>, vector<uint32_t>> groups;
+	for (const LoadedRelocation& r : relocations) {
+		if (compact && r.offset >= MAX_COMPACT_OFFSET) {
+			return false;
+		}
+		groups[{ r.section, r.symbol, r.type }].push_back(r.offset);
+	}
+
+	vector<uint32_t> words = { compact ? RELOCATIONS_COMPACT : RELOCATIONS_PLAIN, (uint32_t) groups.size() };
+	for (auto& group : groups) {
+		vector<uint32_t>& offsets = group.second;
+		sort(offsets.begin(), offsets.end());
+
+		vector<uint32_t> encoded;
+		if (compact) {
+			encode(offsets, encoded);
+		}
+		else {
+			encoded = offsets;
+		}
+		words.push_back(get<0>(group.first));
+		words.push_back(get<1>(group.first));
+		words.push_back(get<2>(group.first));
+		words.push_back((uint32_t) encoded.size());
+		words.insert(words.end(), encoded.begin(), encoded.end());
+	}
+
+	block.resize(words.size() * 4);
+	for (size_t i = 0; i < words.size(); i++) {
+		putLittleEndian(&block[i * 4], words[i]);
+	}
+	return true;
+}
+
+
+// Korak je razmak prve dve relokacije; naredne relokacije na tom koraku idu u bitmape
+// dok se ne pojavi prazna bitmapa, a ostale pocinju novu adresu.
+void RelocationTable::encode(const vector<uint32_t>& offsets, vector<uint32_t>& words) {
+	size_t i = 0;
+	while (i < offsets.size()) {
+		uint32_t offset = offsets[i++];
+		uint32_t stride = 0;
+		if (i < offsets.size() && offsets[i] > offset && offsets[i] - offset <= MAX_STRIDE) {
+			stride = offsets[i] - offset;
+		}
+		words.push_back(offset | (stride << 24));
+		if (stride == 0) {
+			continue;
+		}
+
+		uint32_t base = offset + stride;
+		for (;;) {
+			uint32_t bitmap = 0;
+			while (i < offsets.size() && offsets[i] >= base && offsets[i] < base + 31 * stride && (offsets[i] - base) % stride == 0) {
+				bitmap |= 1u << ((offsets[i] - base) / stride);
+				i++;
+			}
+			if (bitmap == 0) {
+				break;
+			}
+			words.push_back(bitmap | 0x80000000u);
+			base += 31 * stride;
+		}
+	}
+}
+
+
+bool RelocationTable::parse(const char* block, size_t size, vector<LoadedRelocation>& relocations) {
+	if (size < 8 || size % 4 != 0) {
+		return false;
+	}
+	const char* end = block + size;
+	uint32_t encoding = getLittleEndian(block);
+	uint32_t groups = getLittleEndian(block + 4);
+	if (encoding != RELOCATIONS_PLAIN && encoding != RELOCATIONS_COMPACT) {
+		return false;
+	}
+	block += 8;
+
+	for (uint32_t g = 0; g < groups; g++) {
+		if (end - block < 16) {
+			return false;
+		}
+		LoadedRelocation r;
+		r.section = getLittleEndian(block);
+		r.symbol = getLittleEndian(block + 4);
+		r.type = getLittleEndian(block + 8);
+		uint32_t count = getLittleEndian(block + 12);
+		block += 16;
+		if ((size_t) (end - block) / 4 < count) {
+			return false;
+		}
+		const char* groupEnd = block + count * 4;
+
+		if (encoding == RELOCATIONS_PLAIN) {
+			for (; block < groupEnd; block += 4) {
+				r.offset = getLittleEndian(block);
+				relocations.push_back(r);
+			}
+			continue;
+		}
+
+		uint32_t where = 0;
+		uint32_t stride = 0;
+		for (; block < groupEnd; block += 4) {
+			uint32_t word = getLittleEndian(block);
+			if (!(word & 0x80000000u)) {
+				r.offset = word & (MAX_COMPACT_OFFSET - 1);
+				stride = word >> 24;
+				relocations.push_back(r);
+				where = r.offset + stride;
+				continue;
+			}
+			for (uint32_t bits = word & 0x7FFFFFFFu, p = where; bits != 0; bits >>= 1, p += stride) {
+				if (bits & 1) {
+					r.offset = p;
+					relocations.push_back(r);
+				}
+			}
+			where += 31 * stride;
+		}
+	}
+
+	return block == end;
+}
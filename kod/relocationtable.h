@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+using namespace std;
+
+
+
+// Blok relokacija u -f obj. Relokacije iste sekcije, istog simbola i tipa cine grupu,
+// pomeraji u grupi su rastuci. Sva polja su little-endian reci od 4 B.
+//
+//	zaglavlje (8 B):	kodiranje (0 obicno, 1 kompaktno), broj grupa
+//	grupa (16 B):	indeks sekcije u tabeli sekcija, indeks simbola, tip (0 R_386_32, 1 R_386_PC32), broj reci
+//	reci grupe:	obicno, pomeraj svake relokacije; kompaktno (--relr), niz kao u RELR:
+//		bit 31 = 0: adresa, pomeraj (bitovi 0-23) i korak (bitovi 24-30); relokacija je na pomeraju,
+//			a sledece mesto je pomeraj + korak
+//		bit 31 = 1: bitmapa, bit k je relokacija na sledecem mestu + k * korak; mesto se zatim pomera za 31 korak
+//
+// Tabela od 32 pokazivaca na isti simbol je tako 8 B umesto 32 reci.
+
+enum RelocationEncoding : uint32_t { RELOCATIONS_PLAIN = 0, RELOCATIONS_COMPACT = 1 };
+
+
+struct LoadedRelocation {
+	uint32_t section;	// indeks u tabeli sekcija
+	uint32_t offset;
+	uint32_t type;	// RelType
+	uint32_t symbol;	// indeks u tabeli simbola
+};
+
+
+class RelocationTable {
+public:
+	static const uint32_t MAX_COMPACT_OFFSET = 1 << 24;
+	static const uint32_t MAX_STRIDE = 127;
+
+	// false ako kompaktno kodiranje ne moze da zapise pomeraj (sekcija veca od 16 MB)
+	static bool build(const vector<LoadedRelocation>& relocations, bool compact, vector<char>& block);
+	static bool parse(const char* block, size_t size, vector<LoadedRelocation>& relocations);	// false za neispravan blok
+
+	static void encode(const vector<uint32_t>& offsets, vector<uint32_t>& words);	// offsets rastuci
+
+};
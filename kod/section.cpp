@@ -1,88 +1,211 @@
-#include "section.h"
-
-#include <iomanip>
-#include <bitset>
-
-
-Section* const Section::TEXT = new Section("TEXT");
-Section* const Section::DATA = new Section("DATA");
-Section* const Section::RODATA = new Section("RODATA");
-Section* const Section::BSS = new Section("BSS");
-
-
-Section::Section(const string n) : name(n) { }
-
-
-bool Section::checkIfFirstAppearance() {
-	if (firstAppearance) {
-		firstAppearance = false;
-		return true;
-	}
-	else {
-		return false;
-	}
-}
-
-
-void Section::addEntry(Entry entry) {
-	entries.push_back(entry);
-}
-
-
-int Section::size() {
-	if (entries.size() > 0) {
-		Entry& e = entries.back();
-		return e.offset + e.size;
-	}
-	return 0;
-}
-
-
-ostream& operator<<(ostream& os, const Section& s) {
-	os << s.name << endl << endl;
-	os << right;	// treba da bude right zbog setfill ispod
-	for (const Entry& entry : s.entries) {
-		os << entry.offset << '\t';
-		if (entry.size > 0) {
-			for (int i = entry.size - 1; i >= 0; i--) {
-				int val = entry.value;
-				val >>= (i % 4) * 8;
-				val &= 0xFF;
-				os << hex << uppercase << setw(2) << setfill('0') << val << ' ';
-			}
-			os << '\t';
-			if (entry.size <= 3) {
-				os << '\t';
-			}
-			for (int i = entry.size - 1; i >= 0; i--) {
-				int val = entry.value;
-				val >>= (i % 4) * 8;
-				val &= 0xFF;
-				bitset<8> bits(val);
-				os << bits << ' ';
-			}
-		}
-		else /*if (entry.size == -1)*/ {
-			for (int i = 1; i >= 0; i--) {
-				int val = entry.value;
-				val >>= (i % 4) * 8;
-				val &= 0xFF;
-				os << hex << uppercase << setw(2) << setfill('0') << val << ' ';
-			}
-			os << "?? ?? ";
-			os << '\t';
-			for (int i = 1; i >= 0; i--) {
-				int val = entry.value;
-				val >>= (i % 4) * 8;
-				val &= 0xFF;
-				bitset<8> bits(val);
-				os << bits << ' ';
-			}
-			os << "???????? ???????? ";
-		}
-		os << endl;
-	}
-	os << endl << endl << endl;
-
-	return os;
+#include "section.h"
+#include "allocprofile.h"
+
+#include <iomanip>
+#include <bitset>
+
+
+Section::Section(const string n, Arena& arena, bool nb) : entries(arena), blobs(arena), name(n), nobits(nb) { }
+
+
+void Section::reset() {
+	entries = ArenaVector<Entry>(entries.get_allocator());
+	blobs = ArenaVector<const char*>(blobs.get_allocator());
+	firstAppearance = true;
+	locationCounter = 0;
+	reserved = 0;
+	startAddress = -1;
+}
+
+
+bool Section::checkIfFirstAppearance() {
+	if (firstAppearance) {
+		firstAppearance = false;
+		return true;
+	}
+	else {
+		return false;
+	}
+}
+
+
+// Za NOBITS sekciju se pamti samo velicina; vraca false ako je odbacen sadrzaj razlicit od nule.
+bool Section::addEntry(Entry entry) {
+	ALLOC_CATEGORY(CATEGORY_ENTRIES);
+	if (nobits) {
+		int end = entry.offset + (entry.size > 0 ? entry.size : 4);
+		if (end > reserved) {
+			reserved = end;
+		}
+		return entry.value == 0;
+	}
+	entries.push_back(entry);
+	return true;
+}
+
+
+bool Section::accepts(const Entry& entry) const {
+	return !nobits || entry.value == 0;
+}
+
+
+bool Section::addBlob(int offset, const char* data, int size) {
+	ALLOC_CATEGORY(CATEGORY_ENTRIES);
+	if (nobits) {
+		if (offset + size > reserved) {
+			reserved = offset + size;
+		}
+		return false;
+	}
+	Entry entry;
+	entry.offset = offset;
+	entry.value = (int) blobs.size();
+	entry.size = size;
+	entry.type = BLOB_ENTRY;
+	blobs.push_back(data);
+	entries.push_back(entry);
+	return true;
+}
+
+
+int Section::size() const {
+	if (nobits) {
+		return reserved;
+	}
+	if (entries.size() > 0) {
+		const Entry& e = entries.back();
+		return e.offset + (e.size > 0 ? e.size : 4);	// size -1: instrukcija sa nepoznata 2 dodatna bajta
+	}
+	return 0;
+}
+
+
+// Bajtovi sekcije kako se ucitavaju u memoriju. Procesor je little-endian, pa podatak ide
+// od najnizeg bajta, a instrukcija kao rec instrukcije pa dodatna rec, svaka od nizeg bajta.
+// Samo listing ispisuje najvisi bajt prvi. Blobovi se ne kopiraju u bafer, vec se deo slike odnosi direktno na mapirani fajl.
+void Section::image(vector<char>& buffer, vector<ImagePart>& parts) const {
+	size_t needed = 0;
+	for (const Entry& entry : entries) {
+		if (entry.type != BLOB_ENTRY) {
+			needed += (entry.size > 0) ? entry.size : 4;
+		}
+	}
+	buffer.clear();
+	buffer.reserve(needed);	// bez realokacije, pokazivaci u parts ostaju validni
+
+	size_t partStart = 0;
+	for (const Entry& entry : entries) {
+		if (entry.type == BLOB_ENTRY) {
+			if (buffer.size() > partStart) {
+				parts.push_back({ buffer.data() + partStart, (int) (buffer.size() - partStart) });
+			}
+			parts.push_back({ blobs[entry.value], entry.size });
+			partStart = buffer.size();
+		}
+		else if (entry.type == FILL_ENTRY) {
+			buffer.insert(buffer.end(), entry.size, (char) (entry.value & 0xFF));
+		}
+		else if (entry.type == CODE_ENTRY && entry.size == 4) {
+			buffer.push_back((char) ((entry.value >> 16) & 0xFF));
+			buffer.push_back((char) ((entry.value >> 24) & 0xFF));
+			buffer.push_back((char) (entry.value & 0xFF));
+			buffer.push_back((char) ((entry.value >> 8) & 0xFF));
+		}
+		else if (entry.size > 0) {
+			for (int i = 0; i < entry.size; i++) {
+				buffer.push_back((char) ((entry.value >> ((i % 4) * 8)) & 0xFF));
+			}
+		}
+		else {	// dodatna 2 bajta popunjava relokacija
+			buffer.push_back((char) (entry.value & 0xFF));
+			buffer.push_back((char) ((entry.value >> 8) & 0xFF));
+			buffer.push_back(0);
+			buffer.push_back(0);
+		}
+	}
+	if (buffer.size() > partStart) {
+		parts.push_back({ buffer.data() + partStart, (int) (buffer.size() - partStart) });
+	}
+}
+
+
+ostream& operator<<(ostream& os, const Section& s) {
+	os << s.name << endl << endl;
+	if (s.nobits) {
+		os << "NOBITS" << '\t' << dec << s.reserved << " bytes" << endl;
+		os << endl << endl << endl;
+		return os;
+	}
+	os << right;	// treba da bude right zbog setfill ispod
+	for (const Entry& entry : s.entries) {
+		if (entry.type == FILL_ENTRY && entry.size > 8) {	// velika popuna se ispisuje sazeto, a ne bajt po bajt
+			os << entry.offset << '\t';
+			os << hex << uppercase << setw(2) << setfill('0') << (entry.value & 0xFF) << " x " << dec << entry.size << '\t' << "(fill)" << hex << endl;
+			continue;
+		}
+
+		if (entry.type == BLOB_ENTRY) {	// ispisuje se direktno iz mapiranog fajla, u redovima od po 8 bajtova
+			const unsigned char* bytes = (const unsigned char*) s.blobs[entry.value];
+			for (int row = 0; row < entry.size; row += 8) {
+				int n = (entry.size - row < 8) ? (entry.size - row) : 8;
+				os << entry.offset + row << '\t';
+				for (int i = 0; i < n; i++) {
+					os << hex << uppercase << setw(2) << setfill('0') << (int) bytes[row + i] << ' ';
+				}
+				os << '\t';
+				if (n <= 3) {
+					os << '\t';
+				}
+				for (int i = 0; i < n; i++) {
+					bitset<8> bits(bytes[row + i]);
+					os << bits << ' ';
+				}
+				os << endl;
+			}
+			continue;
+		}
+
+		os << entry.offset << '\t';
+		if (entry.size > 0) {
+			for (int i = entry.size - 1; i >= 0; i--) {
+				int val = entry.value;
+				val >>= (i % 4) * 8;
+				val &= 0xFF;
+				os << hex << uppercase << setw(2) << setfill('0') << val << ' ';
+			}
+			os << '\t';
+			if (entry.size <= 3) {
+				os << '\t';
+			}
+			for (int i = entry.size - 1; i >= 0; i--) {
+				int val = entry.value;
+				val >>= (i % 4) * 8;
+				val &= 0xFF;
+				bitset<8> bits(val);
+				os << bits << ' ';
+			}
+		}
+		else /*if (entry.size == -1)*/ {
+			for (int i = 1; i >= 0; i--) {
+				int val = entry.value;
+				val >>= (i % 4) * 8;
+				val &= 0xFF;
+				os << hex << uppercase << setw(2) << setfill('0') << val << ' ';
+			}
+			os << "?? ?? ";
+			os << '\t';
+			for (int i = 1; i >= 0; i--) {
+				int val = entry.value;
+				val >>= (i % 4) * 8;
+				val &= 0xFF;
+				bitset<8> bits(val);
+				os << bits << ' ';
+			}
+			os << "???????? ???????? ";
+		}
+		os << endl;
+	}
+	os << endl << endl << endl;
+
+	return os;
 }
\ No newline at end of file
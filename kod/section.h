@@ -1,47 +1,65 @@
-#pragma once
-
-#include <string>
-#include <vector>
-#include <iostream>
-
-
-
-using namespace std;
-
-
-
-struct Entry {
-	int offset;
-	int value;
-	int size;
-};
-
-
-class Section {
-private:
-	bool firstAppearance = true;
-
-	vector<Entry> entries;
-
-public:
-	static Section* const TEXT;
-	static Section* const DATA;
-	static Section* const RODATA;
-	static Section* const BSS;
-
-	//int locationCounter = 0;
-
-	const string name;
-
-	Section(const string n);
-
-	bool checkIfFirstAppearance();
-
-	void addEntry(Entry entry);
-
-	int startAddress = -1;
-	int size();
-
-	friend ostream& operator<<(ostream& os, const Section& s);
-
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "arena.h"
+
+
+
+using namespace std;
+
+
+
+enum EntryType : char { VALUE_ENTRY, CODE_ENTRY, FILL_ENTRY, BLOB_ENTRY };	// CODE_ENTRY: instrukcija, u slici rec po rec
+
+
+struct Entry {
+	int offset;
+	int value;	// za FILL_ENTRY: bajt za popunu ponovljen 4 puta, za BLOB_ENTRY: indeks u tabeli blobova sekcije
+	int size;
+	EntryType type = VALUE_ENTRY;
+};
+
+
+// Deo binarne slike sekcije: opseg u privremenom baferu ili direktno u mapiranom fajlu.
+struct ImagePart {
+	const char* data;
+	int size;
+};
+
+
+class Section {
+private:
+	bool firstAppearance = true;
+
+	ArenaVector<Entry> entries;	// u areni prevodjenja
+	ArenaVector<const char*> blobs;	// pokazivaci u mapirane fajlove (.incbin)
+
+	int reserved = 0;	// velicina NOBITS sekcije, sadrzaj se ne cuva
+
+public:
+	int locationCounter = 0;	// drugi prolaz: pomeraj na kome se sekcija nastavlja kada se ponovo otvori
+
+	const string name;
+	const bool nobits;
+
+	Section(const string n, Arena& arena, bool nb = false);
+
+	void reset();	// pre ponovnog koriscenja arene
+
+	bool checkIfFirstAppearance();
+
+	bool addEntry(Entry entry);
+	bool accepts(const Entry& entry) const;	// da li addEntry zadrzava sadrzaj, bez upisa
+	bool addBlob(int offset, const char* data, int size);
+
+	int startAddress = -1;
+	int size() const;
+
+	void image(vector<char>& buffer, vector<ImagePart>& parts) const;
+
+	friend ostream& operator<<(ostream& os, const Section& s);
+
 };
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <cstddef>
+
+
+using namespace std;
+
+
+
+// Red bez zakljucavanja za tacno jednog pisca i jednog citaoca (prsten fiksne velicine).
+// Indeksi rastu neograniceno, pozicija je indeks & mask. Svaka strana pamti poslednju
+// vidjenu vrednost tudjeg indeksa i cita atomic tek kada joj ta vrednost ne dozvoljava napredak.
+template <typename T>
+class SpscQueue {
+private:
+	vector<T> slots;
+	const size_t mask;
+
+	alignas(64) atomic<size_t> head{ 0 };	// sledeci za citanje, menja samo citalac
+	size_t cachedTail = 0;
+
+	alignas(64) atomic<size_t> tail{ 0 };	// sledeci za upis, menja samo pisac
+	size_t cachedHead = 0;
+
+	alignas(64) atomic<bool> closed{ false };
+
+	static void wait(int& spins) {
+		if (++spins > 64) {	// druga nit mozda nema svoje jezgro
+			this_thread::yield();
+		}
+	}
+
+public:
+	explicit SpscQueue(size_t capacity) : slots(capacity), mask(capacity - 1) { }	// capacity je stepen dvojke
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Ceka dok se ne oslobodi mesto.
+	void push(T&& value) {
+		size_t t = tail.load(memory_order_relaxed);
+		int spins = 0;
+		while (t - cachedHead == slots.size()) {
+			cachedHead = head.load(memory_order_acquire);
+			if (t - cachedHead == slots.size()) {
+				wait(spins);
+			}
+		}
+		slots[t & mask] = move(value);
+		tail.store(t + 1, memory_order_release);
+	}
+
+	// Ceka na sledeci element; false kada je red zatvoren i prazan.
+	bool pop(T& value) {
+		size_t h = head.load(memory_order_relaxed);
+		int spins = 0;
+		while (h == cachedTail) {
+			cachedTail = tail.load(memory_order_acquire);
+			if (h != cachedTail) {
+				break;
+			}
+			if (closed.load(memory_order_acquire)) {
+				cachedTail = tail.load(memory_order_acquire);	// upis pre zatvaranja
+				if (h == cachedTail) {
+					return false;
+				}
+				break;
+			}
+			wait(spins);
+		}
+		value = move(slots[h & mask]);
+		head.store(h + 1, memory_order_release);
+		return true;
+	}
+
+	void close() {	// poziva pisac, posle poslednjeg push
+		closed.store(true, memory_order_release);
+	}
+
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "instruction.h"
+
+
+using namespace std;
+
+
+
+// Jedna dekodirana naredba izvornog koda.
+// type je LABEL, GLOBAL, SECTION, DIRECTIVE, INSTRUCTION ili END.
+struct Statement {
+	int line;
+	TokenType type;
+	string token;	// mnemonika, direktiva, ime sekcije ili labele (bez ':')
+	vector<string> operands;	// bez zareza; za .incbin ostatak linije
+};
@@ -0,0 +1,47 @@
+#include "stringtable.h"
+
+#include <algorithm>
+
+
+void StringTable::add(string_view name) {
+	if (offsets.emplace(name, 0).second) {
+		names.push_back(name);
+	}
+}
+
+
+void StringTable::finish() {
+	sort(names.begin(), names.end(), [](string_view a, string_view b) {
+		return lexicographical_compare(a.rbegin(), a.rend(), b.rbegin(), b.rend());
+	});
+
+	// od kraja: svako ime je ispred imena cije je mozda kraj, a duze ime sa istim krajem je iza njega
+	string_view previous;
+	uint32_t previousOffset = 0;
+	for (size_t i = names.size(); i-- > 0;) {
+		string_view name = names[i];
+		if (previous.size() >= name.size() && previous.compare(previous.size() - name.size(), name.size(), name) == 0) {
+			offsets[name] = previousOffset + (uint32_t) (previous.size() - name.size());
+			continue;
+		}
+		previous = name;
+		previousOffset = (uint32_t) bytes.size();
+		offsets[name] = previousOffset;
+		bytes.append(name.data(), name.size());
+		bytes.push_back('\0');
+	}
+}
+
+
+uint32_t StringTable::offset(string_view name) const {
+	return offsets.at(name);
+}
+
+
+size_t StringTable::mergedBytes() const {
+	size_t total = 0;
+	for (string_view name : names) {
+		total += name.size() + 1;
+	}
+	return total - bytes.size();
+}
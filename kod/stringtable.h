@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+
+using namespace std;
+
+
+
+// Tabela imena za -f obj: svako ime je jednom, zavrseno nulom. Ime koje je kraj nekog
+// drugog imena deli njegove bajtove (start je u _start), pa je ime u fajlu samo pomeraj.
+// Ista imena imaju isti pomeraj, pa ih citac poredi kao pokazivace.
+//
+// Sva imena se dodaju pre finish(); finish() sortira imena po obrnutom tekstu, pa je
+// ime koje je kraj drugog imena odmah iza njega (ili iza imena sa istim krajem).
+class StringTable {
+private:
+	vector<string_view> names;
+	unordered_map<string_view, uint32_t> offsets;
+	string bytes;
+
+public:
+	void add(string_view name);	// name mora da postoji do finish()
+	void finish();
+
+	uint32_t offset(string_view name) const;	// posle finish()
+	const string& data() const { return bytes; }
+
+	size_t mergedBytes() const;	// bajtovi ustedjeni deljenjem krajeva
+
+};
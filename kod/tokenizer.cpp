@@ -0,0 +1,227 @@
+#include "tokenizer.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TOKENIZER_X86
+#include <immintrin.h>
+#endif
+
+
+// Maske za blok od 64 bajta: bit i odgovara bajtu p[i].
+struct BlockMasks {
+	uint64_t space;	// ' ', \t, \n, \v, \f, \r (isto kao isspace)
+	uint64_t newline;
+	uint64_t comma;
+	uint64_t colon;
+};
+
+
+static void classifyScalar(const char* p, BlockMasks& m) {
+	m.space = m.newline = m.comma = m.colon = 0;
+	for (int i = 0; i < 64; i++) {
+		unsigned char c = (unsigned char) p[i];
+		uint64_t bit = (uint64_t) 1 << i;
+		if (c == ' ' || (c >= '\t' && c <= '\r')) {
+			m.space |= bit;
+		}
+		if (c == '\n') {
+			m.newline |= bit;
+		}
+		else if (c == ',') {
+			m.comma |= bit;
+		}
+		else if (c == ':') {
+			m.colon |= bit;
+		}
+	}
+}
+
+
+#ifdef TOKENIZER_X86
+
+static void classifySse2(const char* p, BlockMasks& m) {
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i four = _mm_set1_epi8(4);
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i colon = _mm_set1_epi8(':');
+
+	m.space = m.newline = m.comma = m.colon = 0;
+	for (int i = 0; i < 4; i++) {
+		__m128i c = _mm_loadu_si128((const __m128i*) (p + 16 * i));
+		__m128i control = _mm_sub_epi8(c, tab);	// \t..\r -> 0..4 (bez znaka)
+		control = _mm_cmpeq_epi8(_mm_min_epu8(control, four), control);
+		__m128i s = _mm_or_si128(_mm_cmpeq_epi8(c, space), control);
+
+		int shift = 16 * i;
+		m.space |= (uint64_t) (uint16_t) _mm_movemask_epi8(s) << shift;
+		m.newline |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(c, newline)) << shift;
+		m.comma |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(c, comma)) << shift;
+		m.colon |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(c, colon)) << shift;
+	}
+}
+
+
+__attribute__((target("avx2")))
+static void classifyAvx2(const char* p, BlockMasks& m) {
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i four = _mm256_set1_epi8(4);
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i comma = _mm256_set1_epi8(',');
+	const __m256i colon = _mm256_set1_epi8(':');
+
+	m.space = m.newline = m.comma = m.colon = 0;
+	for (int i = 0; i < 2; i++) {
+		__m256i c = _mm256_loadu_si256((const __m256i*) (p + 32 * i));
+		__m256i control = _mm256_sub_epi8(c, tab);
+		control = _mm256_cmpeq_epi8(_mm256_min_epu8(control, four), control);
+		__m256i s = _mm256_or_si256(_mm256_cmpeq_epi8(c, space), control);
+
+		int shift = 32 * i;
+		m.space |= (uint64_t) (uint32_t) _mm256_movemask_epi8(s) << shift;
+		m.newline |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(c, newline)) << shift;
+		m.comma |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(c, comma)) << shift;
+		m.colon |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(c, colon)) << shift;
+	}
+}
+
+#endif
+
+
+bool Tokenizer::supported(Kernel kernel) {
+	switch (kernel) {
+	case SCALAR: {
+		return true;
+	}
+#ifdef TOKENIZER_X86
+	case SSE2: {
+		return __builtin_cpu_supports("sse2");
+	}
+	case AVX2: {
+		return __builtin_cpu_supports("avx2");
+	}
+#endif
+	default: {
+		return false;
+	}
+	}
+}
+
+
+Tokenizer::Kernel Tokenizer::best() {
+	static const Kernel kernel = supported(AVX2) ? AVX2 : (supported(SSE2) ? SSE2 : SCALAR);	// samo se cita posle inicijalizacije
+	return kernel;
+}
+
+
+const char* Tokenizer::name(Kernel kernel) {
+	switch (kernel) {
+	case AVX2: {
+		return "avx2";
+	}
+	case SSE2: {
+		return "sse2";
+	}
+	default: {
+		return "scalar";
+	}
+	}
+}
+
+
+// Pocetak tokena je ne-belina posle beline, kraj je belina posle ne-beline.
+// Poceci i krajevi se obradjuju odvojeno (oba dolaze redom), a granica linije
+// je broj tokena zavrsenih pre '\n', dobijen prebrojavanjem bitova.
+void Tokenizer::tokenize(string_view source, TokenizedSource& out, Kernel kernel) {
+	void (*classify)(const char*, BlockMasks&) = classifyScalar;
+#ifdef TOKENIZER_X86
+	if (kernel == AVX2) {
+		classify = classifyAvx2;
+	}
+	else if (kernel == SSE2) {
+		classify = classifySse2;
+	}
+#endif
+
+	const char* data = source.data();
+	size_t size = source.size();
+
+	vector<Token>& tokens = out.tokens;
+	tokens.resize(size / 4 + 64);
+	out.lines.clear();
+	out.lines.reserve(size / 16 + 2);
+	out.lines.push_back(0);
+
+	size_t started = 0;	// broj pocetih tokena
+	size_t ended = 0;	// broj zavrsenih tokena
+	uint64_t previousSpace = 1;	// pocetak ulaza se ponasa kao da mu prethodi belina
+	uint64_t previousComma = 0;
+	uint64_t previousColon = 0;
+
+	for (size_t base = 0; base < size; base += 64) {
+		BlockMasks m;
+		if (size - base >= 64) {
+			classify(data + base, m);
+		}
+		else {	// poslednji blok se dopunjuje razmacima, pa se i poslednji token zavrsava u njemu
+			char tail[64];
+			memset(tail, ' ', sizeof(tail));
+			memcpy(tail, data + base, size - base);
+			classify(tail, m);
+		}
+
+		if (started + 64 > tokens.size()) {
+			tokens.resize(tokens.size() * 2);
+		}
+
+		uint64_t shiftedSpace = (m.space << 1) | previousSpace;
+		uint64_t starts = ~m.space & shiftedSpace;
+		uint64_t ends = m.space & ~shiftedSpace;
+		uint64_t commaEnds = ends & ((m.comma << 1) | previousComma);
+		uint64_t colonEnds = ends & ((m.colon << 1) | previousColon);
+		previousSpace = m.space >> 63;
+		previousComma = m.comma >> 63;
+		previousColon = m.colon >> 63;
+
+		while (starts) {
+			int bit = __builtin_ctzll(starts);
+			tokens[started++].offset = (uint32_t) (base + bit);
+			starts &= starts - 1;
+		}
+
+		size_t endedBefore = ended;
+		while (ends) {
+			int bit = __builtin_ctzll(ends);
+			uint64_t mask = ends & (0 - ends);
+			Token& t = tokens[ended++];
+			t.length = (uint32_t) (base + bit - t.offset);
+			t.flags = ((commaEnds & mask) ? TRAILING_COMMA : 0) | ((colonEnds & mask) ? TRAILING_COLON : 0);
+			ends &= ends - 1;
+		}
+		uint64_t newlines = m.newline;
+		if (newlines) {
+			uint64_t blockEnds = m.space & ~shiftedSpace;
+			while (newlines) {
+				int bit = __builtin_ctzll(newlines);
+				uint64_t upTo = (bit == 63) ? ~(uint64_t) 0 : (((uint64_t) 1 << (bit + 1)) - 1);
+				out.lines.push_back((uint32_t) (endedBefore + __builtin_popcountll(blockEnds & upTo)));
+				newlines &= newlines - 1;
+			}
+		}
+	}
+
+	if (started > ended) {	// token do samog kraja ulaza (velicina deljiva sa 64, bez bloka dopune)
+		Token& t = tokens[ended++];
+		t.length = (uint32_t) (size - t.offset);
+		t.flags = (previousComma ? TRAILING_COMMA : 0) | (previousColon ? TRAILING_COLON : 0);
+	}
+	tokens.resize(ended);
+
+	// poslednja linija bez '\n' se broji kao kod getline; prazan ostatak posle '\n' ne
+	if (size > 0 && data[size - 1] != '\n') {
+		out.lines.push_back((uint32_t) ended);
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+
+using namespace std;
+
+
+
+enum TokenFlags : uint8_t { TRAILING_COMMA = 1, TRAILING_COLON = 2 };
+
+
+// Rec izvornog koda izmedju belina (kao kod istringstream >>), zarez i
+// dvotacka ostaju u tokenu, a flags kaze da li se token njima zavrsava.
+struct Token {
+	uint32_t offset;
+	uint32_t length;
+	uint8_t flags;
+};
+
+
+struct TokenizedSource {
+	vector<Token> tokens;
+	vector<uint32_t> lines;	// lines[i] je indeks prvog tokena linije i; poslednji element je tokens.size()
+
+	size_t lineCount() const { return lines.size() - 1; }
+};
+
+
+// Deli izvor na tokene i linije. Beline, novi redovi, zarezi i dvotacke se traze
+// po 64 bajta odjednom (AVX2 ili SSE2, sa izborom u toku izvrsavanja), a zatim
+// se granice tokena citaju iz bitskih maski.
+class Tokenizer {
+public:
+	enum Kernel { SCALAR, SSE2, AVX2 };
+
+	static Kernel best();
+	static bool supported(Kernel kernel);
+	static const char* name(Kernel kernel);
+
+	static void tokenize(string_view source, TokenizedSource& out, Kernel kernel = best());
+
+};
+
+
+// Citanje tokena jedne linije, kao uzastopni iss >> token.
+class TokenCursor {
+private:
+	string_view source;
+	const Token* current;
+	const Token* last;
+	uint8_t lastFlags = 0;
+
+public:
+	TokenCursor(string_view s, const TokenizedSource& t, size_t line)
+		: source(s), current(t.tokens.data() + t.lines[line]), last(t.tokens.data() + t.lines[line + 1]) { }
+
+	bool next(string& out) {
+		if (current == last) {
+			out.clear();
+			lastFlags = 0;
+			return false;
+		}
+		out.assign(source.data() + current->offset, current->length);
+		lastFlags = current->flags;
+		++current;
+		return true;
+	}
+
+	uint8_t flags() const { return lastFlags; }	// flags poslednjeg procitanog tokena
+
+	const Token* peek() const { return (current == last) ? nullptr : current; }
+
+	// ostatak linije od sledeceg tokena (za .incbin "ime sa razmacima")
+	string rest() {
+		if (current == last) {
+			return "";
+		}
+		size_t begin = current->offset;
+		size_t end = (last - 1)->offset + (last - 1)->length;
+		current = last;
+		return string(source.data() + begin, end - begin);
+	}
+};